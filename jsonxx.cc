@@ -8,12 +8,40 @@
 #include "jsonxx.h"
 
 #include <cctype>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
 #include <iomanip>
 #include <sstream>
 #include <vector>
 #include <limits>
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+#include <set>
+
+#if JSONXX_COMPILER_HAS_CXX11 > 0
+#include <atomic>
+#include <mutex>
+#include <thread>
+#endif
+
+#if defined(_WIN32)
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#ifdef JSONXX_ENABLE_STATS
+#include <time.h>   // clock_gettime for the opt-in entry-point timers
+#endif
+
 // Snippet that creates an assertion function that works both in DEBUG & RELEASE mode.
 // JSONXX_ASSERT(...) macro will redirect to this. assert() macro is kept untouched.
 #if defined(NDEBUG) || defined(_NDEBUG)
@@ -39,6 +67,63 @@ namespace jsonxx {
 
 //static_assert( sizeof(unsigned long long) < sizeof(long double), "'long double' cannot hold 64bit values in this compiler :(");
 
+// 16-byte header keeps the payload aligned for long double
+struct Arena::Block {
+    Block *next;
+    size_t size;
+};
+
+struct Arena::Finalizer {
+    void (*destructor)( void * );
+    void *object;
+    Finalizer *next;
+};
+
+Arena::Arena() : blocks_(0), finalizers_(0), cursor_(0), remaining_(0) {}
+
+Arena::~Arena() {
+    clear();
+}
+
+void *Arena::allocate(size_t size) {
+    enum { block_size = 64 * 1024 };
+    size = ( size + 15 ) & ~size_t(15);
+    if( size > remaining_ ) {
+        size_t payload = size > size_t(block_size) ? size : size_t(block_size);
+        Block *block = static_cast<Block*>( malloc( sizeof(Block) + payload ) );
+        block->next = blocks_;
+        block->size = payload;
+        blocks_ = block;
+        cursor_ = reinterpret_cast<char*>( block + 1 );
+        remaining_ = payload;
+    }
+    void *result = cursor_;
+    cursor_ += size;
+    remaining_ -= size;
+    return result;
+}
+
+void Arena::finalize( void (*destructor)(void *), void *object ) {
+    Finalizer *f = static_cast<Finalizer*>( allocate( sizeof(Finalizer) ) );
+    f->destructor = destructor;
+    f->object = object;
+    f->next = finalizers_;
+    finalizers_ = f;
+}
+
+void Arena::clear() {
+    for( Finalizer *f = finalizers_; f; f = f->next )
+        f->destructor( f->object );
+    finalizers_ = 0;
+    while( blocks_ ) {
+        Block *next = blocks_->next;
+        free( blocks_ );
+        blocks_ = next;
+    }
+    cursor_ = 0;
+    remaining_ = 0;
+}
+
 bool match(const char* pattern, std::istream& input);
 bool parse_array(std::istream& input, Array& array);
 bool parse_bool(std::istream& input, Boolean& value);
@@ -49,6 +134,158 @@ bool parse_object(std::istream& input, Object& object);
 bool parse_string(std::istream& input, String& value);
 bool parse_value(std::istream& input, Value& value);
 
+// Per-parse counters enforcing ParseOptions. The options object stays
+// const and reusable; one ParseState lives on the stack of each budgeted
+// entry point. A null ParseState* anywhere means "no limits" and costs
+// one branch.
+struct ParseFrame;
+
+struct ParseState {
+    explicit ParseState(const ParseOptions &o)
+        : options(&o), depth(0), nodes(0), exceeded(false), frames(0) {}
+    const ParseOptions *options;
+    size_t depth;
+    size_t nodes;
+    // Sticky: once a budget is blown the whole parse is rejected at the
+    // entry point, so the permissive break-on-failed-value recovery can't
+    // mask a violation.
+    bool exceeded;
+    // Heap stack for the iterative engine. A Reader points this at its
+    // reusable scratch; a null pointer means the engine uses a local one.
+    std::vector<ParseFrame> *frames;
+
+    bool push() {
+        ++depth;
+        if (options->max_depth && depth > options->max_depth) exceeded = true;
+        return !exceeded;
+    }
+    void pop() {
+        --depth;
+    }
+    bool count_node() {
+        ++nodes;
+        if (options->max_nodes && nodes > options->max_nodes) exceeded = true;
+        return !exceeded;
+    }
+    bool string_fits(size_t size) {
+        if (options->max_string && size > options->max_string) exceeded = true;
+        return !exceeded;
+    }
+};
+
+// In-memory engine: same grammar as above, but walking a raw char range
+// instead of paying iostream overhead per character.
+bool match(const char* pattern, const char*& cur, const char* end);
+bool parse_array(const char*& cur, const char* end, Array& array, Arena* arena = 0, bool lazy = false, ParseState* state = 0);
+bool parse_bool(const char*& cur, const char* end, Boolean& value);
+bool parse_comment(const char*& cur, const char* end);
+bool parse_null(const char*& cur, const char* end);
+bool parse_integer(const char*& cur, const char* end, long long& value);
+bool parse_number(const char*& cur, const char* end, Number& value);
+bool parse_object(const char*& cur, const char* end, Object& object, Arena* arena = 0, bool lazy = false, ParseState* state = 0);
+bool parse_string(const char*& cur, const char* end, String& value, ParseState* state = 0);
+bool parse_value(const char*& cur, const char* end, Value& value, bool lazy = false, ParseState* state = 0);
+bool parse_iterative(const char*& cur, const char* end, Object* root_object, Array* root_array, Arena* arena, bool lazy, ParseState* state);
+
+// std::set never moves its elements, so pooled strings keep their address
+// for the life of the program.
+const String &intern( const String &key ) {
+    static std::set<String> pool;
+#if JSONXX_COMPILER_HAS_CXX11 > 0
+    static std::mutex mutex;
+    std::lock_guard<std::mutex> lock( mutex );
+#endif
+    return *pool.insert( key ).first;
+}
+
+// -- opt-in stats facility (see Stats in the header) -------------------------
+// The hooks below compile to nothing unless JSONXX_ENABLE_STATS is
+// defined; the snapshot API always exists so callers build either way.
+#ifdef JSONXX_ENABLE_STATS
+
+namespace {
+
+#if JSONXX_COMPILER_HAS_CXX11 > 0
+thread_local Stats stats_counters;
+thread_local int stats_parse_depth = 0;
+thread_local int stats_json_depth = 0;
+#else
+Stats stats_counters;   // pre-C++11: one shared set, callers synchronize
+int stats_parse_depth = 0;
+int stats_json_depth = 0;
+#endif
+
+unsigned long long stats_now_ns() {
+    struct timespec ts;
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return (unsigned long long)ts.tv_sec * 1000000000ull + (unsigned long long)ts.tv_nsec;
+}
+
+// Books bytes and time once per top-level parse: the engines nest (a
+// value parse hands containers to the object/array engines), so only
+// the outermost scope on this thread records anything.
+struct StatsParseScope {
+    const char *const &cur;
+    const char *begin;
+    bool outer;
+    unsigned long long t0;
+    StatsParseScope(const char *const &c)
+        : cur(c), begin(c), outer(stats_parse_depth++ == 0), t0(outer ? stats_now_ns() : 0) {}
+    ~StatsParseScope() {
+        --stats_parse_depth;
+        if (outer) {
+            stats_counters.parses += 1;
+            stats_counters.bytes_parsed += (unsigned long long)(cur - begin);
+            stats_counters.parse_ns += stats_now_ns() - t0;
+        }
+    }
+};
+
+// Same idea for the serializers: a cache fill re-enters stream_tree, so
+// only the outermost scope books the wall time.
+struct StatsJsonScope {
+    bool outer;
+    unsigned long long t0;
+    StatsJsonScope() : outer(stats_json_depth++ == 0), t0(outer ? stats_now_ns() : 0) {}
+    ~StatsJsonScope() {
+        --stats_json_depth;
+        if (outer) stats_counters.json_ns += stats_now_ns() - t0;
+    }
+};
+
+}  // namespace
+
+Stats stats() { return stats_counters; }
+void reset_stats() { stats_counters = Stats(); }
+
+#define JSONXX_STAT_ADD(field, n) ( (void)( stats_counters.field += (unsigned long long)(n) ) )
+#define JSONXX_STAT_MAX(field, n) ( (void)( stats_counters.field < (unsigned long long)(n) ? stats_counters.field = (n) : 0 ) )
+#define JSONXX_STAT_PARSE_SCOPE(cur) StatsParseScope jsonxx_stat_scope_(cur)
+#define JSONXX_STAT_JSON_SCOPE() StatsJsonScope jsonxx_stat_scope_
+
+#else
+
+Stats stats() { return Stats(); }
+void reset_stats() {}
+
+#define JSONXX_STAT_ADD(field, n) ( (void)0 )
+#define JSONXX_STAT_MAX(field, n) ( (void)0 )
+#define JSONXX_STAT_PARSE_SCOPE(cur) ( (void)0 )
+#define JSONXX_STAT_JSON_SCOPE() ( (void)0 )
+
+#endif  // JSONXX_ENABLE_STATS
+
+// Allocate a node either from the arena or from the heap.
+static Value* new_value(Arena* arena) {
+    JSONXX_STAT_ADD(nodes_created, 1);
+    if (!arena) {
+        return new Value();
+    }
+    Value* v = arena->create<Value>();
+    v->arena_ = arena;
+    return v;
+}
+
 // Try to consume characters from the input stream and match the
 // pattern string.
 bool match(const char* pattern, std::istream& input) {
@@ -73,6 +310,82 @@ bool match(const char* pattern, std::istream& input) {
     return *cur == 0;
 }
 
+// Hex digit values for the \u escape decoder, -1 for everything else;
+// a table lookup per digit, no stream objects anywhere on the path.
+static const signed char hex_table[256] = {
+    -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,
+    -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,
+    -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,
+     0, 1, 2, 3, 4, 5, 6, 7, 8, 9,-1,-1,-1,-1,-1,-1,
+    -1,10,11,12,13,14,15,-1,-1,-1,-1,-1,-1,-1,-1,-1,
+    -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,
+    -1,10,11,12,13,14,15,-1,-1,-1,-1,-1,-1,-1,-1,-1,
+    -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,
+    -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,
+    -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,
+    -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,
+    -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,
+    -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,
+    -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,
+    -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,
+    -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,
+};
+
+// Append one code point as UTF-8 (1-4 bytes).
+static void append_utf8(String& value, unsigned long cp) {
+    if (cp < 0x80) {
+        value.push_back(char(cp));
+    } else if (cp < 0x800) {
+        value.push_back(char(0xC0 | (cp >> 6)));
+        value.push_back(char(0x80 | (cp & 0x3F)));
+    } else if (cp < 0x10000) {
+        value.push_back(char(0xE0 | (cp >> 12)));
+        value.push_back(char(0x80 | ((cp >> 6) & 0x3F)));
+        value.push_back(char(0x80 | (cp & 0x3F)));
+    } else {
+        value.push_back(char(0xF0 | (cp >> 18)));
+        value.push_back(char(0x80 | ((cp >> 12) & 0x3F)));
+        value.push_back(char(0x80 | ((cp >> 6) & 0x3F)));
+        value.push_back(char(0x80 | (cp & 0x3F)));
+    }
+}
+
+// Read the four hex digits of a \u escape. The char-range flavor
+// consumes nothing on failure; the istream flavor, like the rest of the
+// stream tokenizer, cannot unread and gives up what it took.
+static bool read_hex4(const char*& cur, const char* end, unsigned long& code) {
+    if (end - cur < 4) {
+        return false;
+    }
+    int a = hex_table[(unsigned char)cur[0]];
+    int b = hex_table[(unsigned char)cur[1]];
+    int c = hex_table[(unsigned char)cur[2]];
+    int d = hex_table[(unsigned char)cur[3]];
+    if ((a | b | c | d) < 0) {
+        return false;
+    }
+    code = (unsigned long)((a << 12) | (b << 8) | (c << 4) | d);
+    cur += 4;
+    return true;
+}
+
+static bool read_hex4(std::istream& input, unsigned long& code) {
+    int value = 0;
+    char ch = '\0';
+    for (int i = 0; i < 4; ++i) {
+        if (!input.get(ch)) {
+            return false;
+        }
+        int digit = hex_table[(unsigned char)ch];
+        if (digit < 0) {
+            return false;
+        }
+        value = (value << 4) | digit;
+    }
+    code = (unsigned long)value;
+    return true;
+}
+
 bool parse_string(std::istream& input, String& value) {
     char ch = '\0', delimiter = '"';
     if (!match("\"", input))  {
@@ -113,14 +426,44 @@ bool parse_string(std::istream& input, String& value) {
                     value.push_back('\t');
                     break;
                 case 'u': {
-                        int i;
-                        std::stringstream ss;
-                        for( i = 0; (!input.eof() && input.good()) && i < 4; ++i ) {
-                            input.get(ch);
-                            ss << ch;
+                        unsigned long cp;
+                        if (!read_hex4(input, cp)) {
+                            append_utf8(value, 0xFFFD);   // broken escape
+                            break;
                         }
-                        if( input.good() && (ss >> i) )
-                            value.push_back(i);
+                        if (cp >= 0xD800 && cp <= 0xDBFF) {
+                            // high surrogate: pair it with a following
+                            // \uDC00..\uDFFF escape
+                            unsigned long lo = 0;
+                            bool have_second = false;
+                            if (input.peek() == '\\') {
+                                input.get(ch);
+                                if (input.peek() == 'u') {
+                                    input.get(ch);
+                                    have_second = read_hex4(input, lo);
+                                    if (!have_second) {
+                                        append_utf8(value, 0xFFFD);   // unpaired unit
+                                        append_utf8(value, 0xFFFD);   // broken escape
+                                        break;
+                                    }
+                                } else {
+                                    input.putback('\\');
+                                }
+                            }
+                            if (have_second && lo >= 0xDC00 && lo <= 0xDFFF) {
+                                cp = 0x10000 + ((cp - 0xD800) << 10) + (lo - 0xDC00);
+                            } else if (have_second) {
+                                // not a low surrogate: the first unit is
+                                // unpaired, the second stands alone
+                                append_utf8(value, 0xFFFD);
+                                cp = (lo >= 0xD800 && lo <= 0xDFFF) ? 0xFFFD : lo;
+                            } else {
+                                cp = 0xFFFD;
+                            }
+                        } else if (cp >= 0xDC00 && cp <= 0xDFFF) {
+                            cp = 0xFFFD;   // lone low surrogate
+                        }
+                        append_utf8(value, cp);
                     }
                     break;
                 default:
@@ -220,237 +563,1239 @@ bool parse_value(std::istream& input, Value& value) {
     return value.parse(input);
 }
 
-
-Object::Object() : value_map_() {}
-
-Object::~Object() {
-    reset();
+static void skip_whitespace(const char*& cur, const char* end) {
+    while (cur < end && std::isspace((unsigned char)*cur)) {
+        ++cur;
+    }
 }
 
-bool Object::parse(std::istream& input, Object& object) {
-    object.reset();
-
-    if (!match("{", input)) {
+// Scan for the next byte the string parser has to inspect (the closing
+// delimiter or a backslash); everything before it is a clean run that can
+// be appended in bulk. The SSE2/NEON kernels check 16 bytes per step;
+// other platforms fall through to the scalar loop.
+static const char* scan_string_run(const char* cur, const char* end, char delimiter) {
+#if defined(__SSE2__)
+    const __m128i delim = _mm_set1_epi8(delimiter);
+    const __m128i slash = _mm_set1_epi8('\\');
+    while (end - cur >= 16) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(cur));
+        __m128i hits = _mm_or_si128(_mm_cmpeq_epi8(chunk, delim),
+                                    _mm_cmpeq_epi8(chunk, slash));
+        int mask = _mm_movemask_epi8(hits);
+        if (mask) {
+            return cur + __builtin_ctz((unsigned)mask);
+        }
+        cur += 16;
+    }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    const uint8x16_t delim = vdupq_n_u8((unsigned char)delimiter);
+    const uint8x16_t slash = vdupq_n_u8('\\');
+    while (end - cur >= 16) {
+        uint8x16_t chunk = vld1q_u8(reinterpret_cast<const uint8_t*>(cur));
+        uint8x16_t hits = vorrq_u8(vceqq_u8(chunk, delim),
+                                   vceqq_u8(chunk, slash));
+        if (vmaxvq_u8(hits)) {
+            break;  // the scalar loop below locates the byte
+        }
+        cur += 16;
+    }
+#endif
+    while (cur < end && *cur != delimiter && *cur != '\\') {
+        ++cur;
+    }
+    return cur;
+}
+
+// Same idea for the serializer: find the next byte escape_string() has to
+// replace (a control byte or one of " \ /); clean runs are copied whole.
+static const char* scan_escape_run(const char* cur, const char* end) {
+#if defined(__SSE2__)
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i bslash = _mm_set1_epi8('\\');
+    const __m128i fslash = _mm_set1_epi8('/');
+    const __m128i ctrl = _mm_set1_epi8(0x1f);
+    while (end - cur >= 16) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(cur));
+        __m128i hits = _mm_or_si128(_mm_cmpeq_epi8(chunk, quote),
+                                    _mm_cmpeq_epi8(chunk, bslash));
+        hits = _mm_or_si128(hits, _mm_cmpeq_epi8(chunk, fslash));
+        // chunk <= 0x1f, compared unsigned so UTF-8 bytes stay clean
+        hits = _mm_or_si128(hits, _mm_cmpeq_epi8(_mm_min_epu8(chunk, ctrl), chunk));
+        int mask = _mm_movemask_epi8(hits);
+        if (mask) {
+            return cur + __builtin_ctz((unsigned)mask);
+        }
+        cur += 16;
+    }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    const uint8x16_t quote = vdupq_n_u8('"');
+    const uint8x16_t bslash = vdupq_n_u8('\\');
+    const uint8x16_t fslash = vdupq_n_u8('/');
+    const uint8x16_t ctrl = vdupq_n_u8(0x20);
+    while (end - cur >= 16) {
+        uint8x16_t chunk = vld1q_u8(reinterpret_cast<const uint8_t*>(cur));
+        uint8x16_t hits = vorrq_u8(vceqq_u8(chunk, quote),
+                                   vceqq_u8(chunk, bslash));
+        hits = vorrq_u8(hits, vceqq_u8(chunk, fslash));
+        hits = vorrq_u8(hits, vcltq_u8(chunk, ctrl));
+        if (vmaxvq_u8(hits)) {
+            break;  // the scalar loop below locates the byte
+        }
+        cur += 16;
+    }
+#endif
+    while (cur < end) {
+        unsigned char ch = (unsigned char)*cur;
+        if (ch < 0x20 || ch == '"' || ch == '\\' || ch == '/') {
+            break;
+        }
+        ++cur;
+    }
+    return cur;
+}
+
+// Try to consume characters from the char range and match the
+// pattern string. 'cur' is only advanced on a successful match.
+bool match(const char* pattern, const char*& cur, const char* end) {
+    skip_whitespace(cur, end);
+    const char* p = cur;
+    while (p < end && *pattern != 0) {
+        if (*p != *pattern) {
+            const char* rewind = p;
+            if (parse_comment(rewind, end)) {
+                p = rewind;
+                continue;
+            }
+            return false;
+        }
+        ++p;
+        ++pattern;
+    }
+    if (*pattern != 0) {
         return false;
     }
-    if (match("}", input)) {
+    cur = p;
+    return true;
+}
+
+bool parse_comment(const char*& cur, const char* end) {
+    if( Parser == Permissive )
+    if( cur + 1 < end && cur[0] == '/' && cur[1] == '/' )
+    {
+        // trim chars till \r or \n
+        cur += 2;
+        while( cur < end && *cur != '\r' && *cur != '\n' )
+            ++cur;
+
+        // consume spaces, tabs, \r or \n, in case no eof is found
+        skip_whitespace(cur, end);
         return true;
     }
 
-    do {
-        std::string key;
-        if (!parse_string(input, key)) {
-            if (Parser == Permissive) {
-                if (input.peek() == '}')
-                    break;
-            }
+    return false;
+}
+
+bool parse_string(const char*& cur, const char* end, String& value, ParseState* state) {
+    char ch = '\0', delimiter = '"';
+    if (!match("\"", cur, end))  {
+        if (Parser == Strict) {
             return false;
         }
-        if (!match(":", input)) {
+        delimiter = '\'';
+        if (cur >= end || *cur != delimiter) {
             return false;
         }
-        Value* v = new Value();
-        if (!parse_value(input, *v)) {
-            delete v;
-            break;
+        ++cur;
+    }
+    while(cur < end) {
+        const char* run = scan_string_run(cur, end, delimiter);
+        if (run > cur) {
+            value.append(cur, run);
+            cur = run;
+            if (state && !state->string_fits(value.size())) {
+                return false;   // over budget: stop before the string grows further
+            }
+            if (cur >= end) {
+                break;
+            }
         }
-        object.value_map_[key] = v;
-    } while (match(",", input));
-
+        ch = *cur++;
+        if (ch == delimiter) {
+            JSONXX_STAT_ADD(strings_parsed, 1);
+            return state ? state->string_fits(value.size()) : true;
+        }
+        if (ch == '\\') {
+            if (cur >= end) {
+                break;
+            }
+            ch = *cur++;
+            switch(ch) {
+                case '\\':
+                case '/':
+                    value.push_back(ch);
+                    break;
+                case 'b':
+                    value.push_back('\b');
+                    break;
+                case 'f':
+                    value.push_back('\f');
+                    break;
+                case 'n':
+                    value.push_back('\n');
+                    break;
+                case 'r':
+                    value.push_back('\r');
+                    break;
+                case 't':
+                    value.push_back('\t');
+                    break;
+                case 'u': {
+                        unsigned long cp;
+                        if (!read_hex4(cur, end, cp)) {
+                            // broken escape: the offending chars stay in
+                            // the input and come through literally
+                            append_utf8(value, 0xFFFD);
+                            break;
+                        }
+                        if (cp >= 0xD800 && cp <= 0xDBFF) {
+                            // high surrogate: pair it with a following
+                            // \uDC00..\uDFFF escape. Anything else is
+                            // left for the main loop to reprocess.
+                            unsigned long lo = 0;
+                            const char* mark = cur;
+                            bool paired = false;
+                            if (cur + 1 < end && cur[0] == '\\' && cur[1] == 'u') {
+                                cur += 2;
+                                paired = read_hex4(cur, end, lo)
+                                    && lo >= 0xDC00 && lo <= 0xDFFF;
+                            }
+                            if (paired) {
+                                cp = 0x10000 + ((cp - 0xD800) << 10) + (lo - 0xDC00);
+                            } else {
+                                cur = mark;
+                                cp = 0xFFFD;
+                            }
+                        } else if (cp >= 0xDC00 && cp <= 0xDFFF) {
+                            cp = 0xFFFD;   // lone low surrogate
+                        }
+                        append_utf8(value, cp);
+                    }
+                    break;
+                default:
+                    if (ch != delimiter) {
+                        value.push_back('\\');
+                        value.push_back(ch);
+                    } else value.push_back(ch);
+                    break;
+            }
+        } else {
+            value.push_back(ch);
+        }
+    }
+    return false;
+}
 
-    if (!match("}", input)) {
+// Integer fast path: an all-digit token that fits 64 bits is stored
+// exactly, without converting through long double. Fails (leaving 'cur'
+// untouched) on fractions, exponents and overflow so parse_number can
+// re-scan the token.
+bool parse_integer(const char*& cur, const char* end, long long& value) {
+    skip_whitespace(cur, end);
+    const char* p = cur;
+    bool negative = false;
+    if (p < end && (*p == '+' || *p == '-')) {
+        negative = (*p == '-');
+        ++p;
+    }
+    if (p >= end || !std::isdigit((unsigned char)*p)) {
         return false;
     }
-
+    unsigned long long magnitude = 0;
+    while (p < end && std::isdigit((unsigned char)*p)) {
+        unsigned digit = unsigned(*p - '0');
+        if (magnitude > (ULLONG_MAX - digit) / 10) {
+            return false;
+        }
+        magnitude = magnitude * 10 + digit;
+        ++p;
+    }
+    if (p < end && (*p == '.' || *p == 'e' || *p == 'E')) {
+        return false;
+    }
+    unsigned long long limit = negative
+        ? (unsigned long long)(LLONG_MAX) + 1
+        : (unsigned long long)(LLONG_MAX);
+    if (magnitude > limit) {
+        return false;
+    }
+    value = (long long)(negative ? 0ULL - magnitude : magnitude);
+    cur = p;
+    JSONXX_STAT_ADD(numbers_parsed, 1);
     return true;
 }
 
-Value::Value() : type_(INVALID_) {}
-
-void Value::reset() {
-    if (type_ == STRING_) {
-        delete string_value_;
-        string_value_ = 0;
+// Scan the number token shape the istream extractor accepts:
+// [+-]? digits [. digits] [eE [+-] digits], at least one digit.
+// Returns one past the token, or 0 if no number starts at 'cur'.
+// Shared by parse_number and the validating walker below so both
+// agree on what a number is.
+static const char* scan_number_token(const char* cur, const char* end) {
+    const char* p = cur;
+    bool digits = false;
+    if (p < end && (*p == '+' || *p == '-')) {
+        ++p;
     }
-    else if (type_ == OBJECT_) {
-        delete object_value_;
-        object_value_ = 0;
+    while (p < end && std::isdigit((unsigned char)*p)) {
+        ++p;
+        digits = true;
     }
-    else if (type_ == ARRAY_) {
-        delete array_value_;
-        array_value_ = 0;
+    if (p < end && *p == '.') {
+        ++p;
+        while (p < end && std::isdigit((unsigned char)*p)) {
+            ++p;
+            digits = true;
+        }
+    }
+    if (!digits) {
+        return 0;
+    }
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        const char* exponent = p + 1;
+        if (exponent < end && (*exponent == '+' || *exponent == '-')) {
+            ++exponent;
+        }
+        bool exponent_digits = false;
+        while (exponent < end && std::isdigit((unsigned char)*exponent)) {
+            ++exponent;
+            exponent_digits = true;
+        }
+        if (exponent_digits) {
+            p = exponent;
+        }
     }
+    return p;
 }
 
-bool Value::parse(std::istream& input, Value& value) {
-    value.reset();
+bool parse_number(const char*& cur, const char* end, Number& value) {
+    skip_whitespace(cur, end);
 
-    std::string string_value;
-    if (parse_string(input, string_value)) {
-        value.string_value_ = new std::string();
-        value.string_value_->swap(string_value);
-        value.type_ = STRING_;
-        return true;
+    const char* p = scan_number_token(cur, end);
+    if (!p) {
+        return false;
     }
-    if (parse_number(input, value.number_value_)) {
-        value.type_ = NUMBER_;
-        return true;
+
+    char buffer[96];
+    size_t size = size_t(p - cur);
+    if (size < sizeof(buffer)) {
+        memcpy(buffer, cur, size);
+        buffer[size] = '\0';
+        value = strtold(buffer, 0);
+    } else {
+        value = strtold(std::string(cur, p).c_str(), 0);
     }
+    cur = p;
+    JSONXX_STAT_ADD(numbers_parsed, 1);
+    return true;
+}
 
-    if (parse_bool(input, value.bool_value_)) {
-        value.type_ = BOOL_;
+bool parse_bool(const char*& cur, const char* end, Boolean& value) {
+    if (match("true", cur, end))  {
+        value = true;
         return true;
     }
-    if (parse_null(input)) {
-        value.type_ = NULL_;
+    if (match("false", cur, end)) {
+        value = false;
         return true;
     }
-    if (input.peek() == '[') {
-        value.array_value_ = new Array();
-        if (parse_array(input, *value.array_value_)) {
-            value.type_ = ARRAY_;
-            return true;
-        }
-        delete value.array_value_;
-    }
-    value.object_value_ = new Object();
-    if (parse_object(input, *value.object_value_)) {
-        value.type_ = OBJECT_;
+    return false;
+}
+
+bool parse_null(const char*& cur, const char* end) {
+    if (match("null", cur, end))  {
         return true;
     }
-    delete value.object_value_;
-    return false;
+    if (Parser == Strict) {
+        return false;
+    }
+    return (cur < end && *cur == ',');
 }
 
-Array::Array() : values_() {}
+bool parse_array(const char*& cur, const char* end, Array& array, Arena* arena, bool lazy, ParseState* state) {
+    return Array::parse(cur, end, array, arena, lazy, state);
+}
 
-Array::~Array() {
-    reset();
+bool parse_object(const char*& cur, const char* end, Object& object, Arena* arena, bool lazy, ParseState* state) {
+    return Object::parse(cur, end, object, arena, lazy, state);
 }
 
-bool Array::parse(std::istream& input, Array& array) {
-    array.reset();
+bool parse_value(const char*& cur, const char* end, Value& value, bool lazy, ParseState* state) {
+    return Value::parse(cur, end, value, lazy, state);
+}
 
-    if (!match("[", input)) {
-        return false;
-    }
-    if (match("]", input)) {
-        return true;
+// Skip one balanced {...} or [...] region without building anything,
+// honoring strings (both quote flavors) and // comments so braces inside
+// them don't count. Leaves 'cur' one past the matching closer.
+static bool skip_balanced(const char*& cur, const char* end) {
+    int depth = 0;
+    while (cur < end) {
+        char ch = *cur;
+        if (ch == '"' || ch == '\'') {
+            char delimiter = ch;
+            ++cur;
+            while (cur < end) {
+                cur = scan_string_run(cur, end, delimiter);
+                if (cur >= end) break;
+                if (*cur == '\\') {
+                    cur += (cur + 1 < end) ? 2 : 1;
+                } else {
+                    ++cur;
+                    break;
+                }
+            }
+        } else if (ch == '/' && parse_comment(cur, end)) {
+            continue;
+        } else if (ch == '{' || ch == '[') {
+            ++depth;
+            ++cur;
+        } else if (ch == '}' || ch == ']') {
+            --depth;
+            ++cur;
+            if (depth == 0) return true;
+            if (depth < 0) return false;
+        } else {
+            ++cur;
+        }
     }
+    return false;
+}
 
+// Skip one string token without building the value. Accepts the same
+// input as parse_string (both quote flavors in Permissive mode) and
+// reuses its delimiter scanner.
+static bool skip_string(const char*& cur, const char* end) {
+    char delimiter = '"';
+    if (!match("\"", cur, end)) {
+        if (Parser == Strict) {
+            return false;
+        }
+        delimiter = '\'';
+        if (cur >= end || *cur != delimiter) {
+            return false;
+        }
+        ++cur;
+    }
+    while (cur < end) {
+        cur = scan_string_run(cur, end, delimiter);
+        if (cur >= end) {
+            break;
+        }
+        if (*cur == '\\') {
+            cur += (cur + 1 < end) ? 2 : 1;
+        } else {
+            ++cur;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Event engine: walks the same grammar as the DOM parse above, sharing
+// the tokenizer helpers, but reports tokens to a ParseHandler instead of
+// building nodes. 'scratch' is reused for every key and string so a full
+// document walk does not allocate per token, and nesting state lives in
+// an explicit stack at one byte per open container -- like the DOM and
+// validation engines, depth is bounded by memory, not the thread stack.
+namespace {
+
+struct EventParser {
+    EventParser(ParseHandler &h) : handler(&h), aborted(false) {}
+    ParseHandler *handler;
+    String scratch;
+    bool aborted;
+};
+
+// One scalar: fires the matching handler event. False when the cursor
+// does not sit on a scalar, or when the handler aborted the walk --
+// parser.aborted tells the two apart.
+bool parse_scalar_events(const char*& cur, const char* end, EventParser& parser) {
+    parser.scratch.clear();
+    if (parse_string(cur, end, parser.scratch)) {
+        if (!parser.handler->string(parser.scratch)) {
+            parser.aborted = true;
+            return false;
+        }
+        return true;
+    }
+    long long int_value;
+    if (parse_integer(cur, end, int_value)) {
+        if (!parser.handler->integer(int_value)) {
+            parser.aborted = true;
+            return false;
+        }
+        return true;
+    }
+    Number number_value;
+    if (parse_number(cur, end, number_value)) {
+        if (!parser.handler->number(number_value)) {
+            parser.aborted = true;
+            return false;
+        }
+        return true;
+    }
+    Boolean bool_value;
+    if (parse_bool(cur, end, bool_value)) {
+        if (!parser.handler->boolean(bool_value)) {
+            parser.aborted = true;
+            return false;
+        }
+        return true;
+    }
+    if (parse_null(cur, end)) {
+        if (!parser.handler->null()) {
+            parser.aborted = true;
+            return false;
+        }
+        return true;
+    }
+    return false;
+}
+
+// Containers: explicit-stack machine in the shape of parse_iterative
+// and the validating walker. OPEN enters the container under the
+// cursor, ELEMENT consumes one member, NEXT looks for the separator,
+// CLOSE matches the closer and pops; a failed member falls through to
+// CLOSE on the enclosing frame, preserving the permissive recovery of
+// the recursive engine this replaces. Begin/end events bracket each
+// successfully opened and closed container; an abort from the handler
+// stops the walk on the spot.
+bool parse_container_events(const char*& cur, const char* end, EventParser& parser) {
+    enum { OPEN, ELEMENT, NEXT, CLOSE } mode = OPEN;
+    std::string closers;   // one byte per open container
+
+    for (;;) {
+        if (mode == OPEN) {
+            bool object = !(cur < end && *cur == '[');
+            if (!match(object ? "{" : "[", cur, end)) {
+                // no value where one was required: the enclosing
+                // container falls through to its closer
+                if (closers.empty())
+                    return false;
+                mode = CLOSE;
+                continue;
+            }
+            if (!(object ? parser.handler->begin_object()
+                         : parser.handler->begin_array())) {
+                parser.aborted = true;
+                return false;
+            }
+            if (match(object ? "}" : "]", cur, end)) {
+                if (!(object ? parser.handler->end_object()
+                             : parser.handler->end_array())) {
+                    parser.aborted = true;
+                    return false;
+                }
+                if (closers.empty())
+                    return true;
+                mode = NEXT;
+            } else {
+                closers += object ? '}' : ']';
+                mode = ELEMENT;
+            }
+        } else if (mode == ELEMENT) {
+            if (closers[closers.size() - 1] == '}') {
+                parser.scratch.clear();
+                if (!parse_string(cur, end, parser.scratch)) {
+                    if (Parser == Permissive && cur < end && *cur == '}') {
+                        mode = CLOSE;
+                        continue;
+                    }
+                    // malformed key: this frame fails without trying its
+                    // closer, and the parent falls through to CLOSE
+                    closers.erase(closers.size() - 1);
+                    if (closers.empty())
+                        return false;
+                    mode = CLOSE;
+                    continue;
+                }
+                if (!parser.handler->key(parser.scratch)) {
+                    parser.aborted = true;
+                    return false;
+                }
+                if (!match(":", cur, end)) {
+                    closers.erase(closers.size() - 1);
+                    if (closers.empty())
+                        return false;
+                    mode = CLOSE;
+                    continue;
+                }
+            }
+            if (parse_scalar_events(cur, end, parser)) {
+                mode = NEXT;
+            } else if (parser.aborted) {
+                return false;
+            } else {
+                mode = OPEN;
+            }
+        } else if (mode == NEXT) {
+            mode = match(",", cur, end) ? ELEMENT : CLOSE;
+        } else { // CLOSE
+            char closer = closers[closers.size() - 1];
+            closers.erase(closers.size() - 1);
+            if (match(closer == '}' ? "}" : "]", cur, end)) {
+                if (!(closer == '}' ? parser.handler->end_object()
+                                    : parser.handler->end_array())) {
+                    parser.aborted = true;
+                    return false;
+                }
+                if (closers.empty())
+                    return true;
+                mode = NEXT;
+            } else {
+                // unbalanced: fail this frame without its end event, and
+                // let the enclosing frame try to close over it
+                if (closers.empty())
+                    return false;
+                mode = CLOSE;
+            }
+        }
+    }
+}
+
+} // namespace jsonxx::anon
+
+bool parse_events(const char *begin, const char *end, ParseHandler &handler) {
+    EventParser parser(handler);
+    const char *cur = begin;
+    if (parse_scalar_events(cur, end, parser))
+        return true;
+    if (parser.aborted)
+        return false;
+    return parse_container_events(cur, end, parser);
+}
+
+bool parse_events(const char *data, size_t size, ParseHandler &handler) {
+    return parse_events(data, data + size, handler);
+}
+
+bool parse_events(const std::string &input, ParseHandler &handler) {
+    return parse_events(input.data(), input.data() + input.size(), handler);
+}
+
+bool parse_events(std::istream &input, ParseHandler &handler) {
+    std::ostringstream ss;
+    ss << input.rdbuf();
+    const std::string &buffer = ss.str();
+    return parse_events(buffer.data(), buffer.data() + buffer.size(), handler);
+}
+
+
+Object::Object() : value_map_(), cache_(0) {}
+
+Object::~Object() {
+    reset();
+    delete cache_;
+}
+
+// One suspended container of the iterative engine below; exactly one of
+// object/array is set. 'slot' is the Value owning the container (null
+// for the root, whose target the caller owns), and 'key' is the scratch
+// key of the element currently being parsed -- a finished child files
+// itself under its parent's key. Keeping the scratch per frame means
+// only the first oversized key at each level pays a heap allocation and
+// the siblings reuse its capacity, as the recursive engine's one scratch
+// string per activation did.
+struct ParseFrame {
+    Object* object;
+    Array* array;
+    Value* slot;
+    std::string key;
+    bool lazy;
+    bool tried_object;   // array-to-object retry already spent
+};
+
+// Iterative replacement for the old Object::parse / parse_value /
+// Array::parse mutual recursion on the char path: nesting depth lives in
+// an explicit heap stack instead of C stack frames, so documents tens of
+// thousands of levels deep parse without overflowing a thread stack.
+// Control flow mirrors the recursive engine, including the permissive
+// break-on-failed-value recovery at every level and the one
+// array-then-object retry a failed '[' value gets.
+bool parse_iterative(const char*& cur, const char* end, Object* root_object, Array* root_array, Arena* arena, bool lazy, ParseState* state) {
+    std::vector<ParseFrame> local;
+    std::vector<ParseFrame>& frames = state && state->frames ? *state->frames : local;
+    frames.clear();
+
+    {
+        ParseFrame root;
+        root.object = root_object;
+        root.array = root_array;
+        root.slot = 0;
+        root.lazy = lazy;
+        root.tried_object = true;   // the retry belongs to values, not roots
+        if (root.object) {
+            root.object->reset();
+            if (!match("{", cur, end))
+                return false;
+        } else {
+            root.array->reset();
+            if (!match("[", cur, end))
+                return false;
+        }
+        if (state && !state->push()) {
+            return false;   // depth budget; a failed parse never pops
+        }
+        frames.push_back(root);
+        JSONXX_STAT_MAX(peak_depth, frames.size());
+    }
+
+    enum { OPENED, ELEMENT, NEXT, CLOSE, DONE, FAIL } mode = OPENED;
+
+    while (!frames.empty()) {
+        ParseFrame& f = frames.back();
+
+        if (mode == OPENED) {
+            if (match(f.object ? "}" : "]", cur, end)) {
+                if (state) state->pop();
+                mode = DONE;
+                continue;
+            }
+            if (f.array && frames.size() == 1) {
+                // Pre-size the root modestly from the remaining input (an
+                // element takes at least two bytes). Root only: sizing
+                // every frame from the remaining document would claim up
+                // to the cap for each nested or sibling array. Inner
+                // arrays grow normally, or through a caller-side
+                // Array::reserve(), which a larger hint never shrinks.
+                size_t hint = size_t(end - cur) / 16;
+                f.array->values_.reserve(hint < 4096 ? hint : 4096);
+            }
+            mode = ELEMENT;
+            continue;
+        }
+
+        if (mode == ELEMENT) {
+            if (f.object) {
+                f.key.clear();
+                if (!parse_string(cur, end, f.key, state)) {
+                    if (Parser == Permissive && cur < end && *cur == '}') {
+                        mode = CLOSE;
+                        continue;
+                    }
+                    mode = FAIL;
+                    continue;
+                }
+                if (!match(":", cur, end)) {
+                    mode = FAIL;
+                    continue;
+                }
+            }
+            Value* v = new_value(arena);
+            if (state && !state->count_node()) {
+                if (!arena) delete v;
+                mode = FAIL;
+                continue;
+            }
+
+            // scalars first, in the same order Value::parse tries them
+            bool scalar = false;
+            std::string string_value;
+            if (parse_string(cur, end, string_value, state)) {
+                if (string_value.size() <= (size_t)Value::SSTRING_CAPACITY) {
+                    v->set_sstring(string_value.data(), string_value.size());
+                    v->type_ = Value::SSTRING_;
+                } else {
+                    v->string_value_ = v->make_string();
+                    v->string_value_->swap(string_value);
+                    v->type_ = Value::STRING_;
+                }
+                scalar = true;
+            } else if (parse_integer(cur, end, v->int_value_)) {
+                v->type_ = Value::INT_;
+                scalar = true;
+            } else if (parse_number(cur, end, v->number_value_)) {
+                v->type_ = Value::NUMBER_;
+                scalar = true;
+            } else if (parse_bool(cur, end, v->bool_value_)) {
+                v->type_ = Value::BOOL_;
+                scalar = true;
+            } else if (parse_null(cur, end)) {
+                v->type_ = Value::NULL_;
+                scalar = true;
+            } else if (f.lazy) {
+                skip_whitespace(cur, end);
+                if (cur < end && (*cur == '[' || *cur == '{')) {
+                    const char* begin = cur;
+                    if (skip_balanced(cur, end)) {
+                        v->raw_value_.begin = begin;
+                        v->raw_value_.end = cur;
+                        v->type_ = Value::RAW_;
+                        scalar = true;
+                    } else {
+                        cur = begin;  // unbalanced: parse it eagerly below
+                    }
+                }
+            }
+            if (scalar) {
+                if (f.object) {
+                    Value*& slot = f.object->assign(f.key);
+                    if (slot && !slot->arena_) delete slot;
+                    slot = v;
+                } else {
+                    f.array->values_.push_back(v);
+                }
+                mode = NEXT;
+                continue;
+            }
+
+            // container value: open a child frame and keep looping. The
+            // container is wired into the Value up front so a later
+            // failure tears down the partial subtree through 'delete v'.
+            skip_whitespace(cur, end);
+            ParseFrame child;
+            child.slot = v;
+            child.lazy = false;   // a lazy parent only gets here when the slice was unbalanced
+            if (cur < end && *cur == '[' && match("[", cur, end)) {
+                v->array_value_ = v->make_array();
+                v->type_ = Value::ARRAY_;
+                child.object = 0;
+                child.array = v->array_value_;
+                child.tried_object = false;
+            } else if (match("{", cur, end)) {
+                v->object_value_ = v->make_object();
+                v->type_ = Value::OBJECT_;
+                child.object = v->object_value_;
+                child.array = 0;
+                child.tried_object = true;
+            } else {
+                // not a value at all: the parent breaks and tries to close
+                if (!arena) delete v;
+                mode = CLOSE;
+                continue;
+            }
+            if (state && !state->push()) {
+                if (!arena) delete v;
+                mode = FAIL;
+                continue;
+            }
+            frames.push_back(child);   // invalidates 'f'
+            JSONXX_STAT_MAX(peak_depth, frames.size());
+            mode = OPENED;
+            continue;
+        }
+
+        if (mode == NEXT) {
+            mode = match(",", cur, end) ? ELEMENT : CLOSE;
+            continue;
+        }
+
+        if (mode == CLOSE) {
+            if (!match(f.object ? "}" : "]", cur, end)) {
+                mode = FAIL;
+                continue;
+            }
+            if (state) state->pop();
+            mode = DONE;
+            continue;
+        }
+
+        if (mode == DONE) {
+            // container finished: file it in the parent and resume there
+            Value* v = f.slot;
+            frames.pop_back();
+            if (frames.empty())
+                return true;   // root closed
+            ParseFrame& p = frames.back();
+            if (p.object) {
+                Value*& slot = p.object->assign(p.key);
+                if (slot && !slot->arena_) delete slot;
+                slot = v;
+            } else {
+                p.array->values_.push_back(v);
+            }
+            mode = NEXT;
+            continue;
+        }
+
+        // mode == FAIL
+        {
+            // a failed '[' value gets one shot at reparsing as an object
+            // from wherever the array attempt stopped, as the recursive
+            // Value::parse allowed
+            if (f.array && f.slot && !f.tried_object && match("{", cur, end)) {
+                f.slot->reset();
+                f.slot->object_value_ = f.slot->make_object();
+                f.slot->type_ = Value::OBJECT_;
+                f.object = f.slot->object_value_;
+                f.array = 0;
+                f.tried_object = true;
+                if (state && !state->push()) {
+                    mode = FAIL;
+                    continue;
+                }
+                mode = OPENED;
+                continue;
+            }
+            Value* v = f.slot;
+            frames.pop_back();
+            if (frames.empty())
+                return false;   // root failed
+            if (v && !arena) delete v;
+            // permissive recovery: the parent treats the failed value as
+            // the end of its element list and tries to close
+            mode = CLOSE;
+            continue;
+        }
+    }
+    return false;
+}
+
+bool Object::parse(const char*& cur, const char* end, Object& object, Arena* arena, bool lazy, ParseState* state) {
+    JSONXX_STAT_PARSE_SCOPE(cur);
+    return parse_iterative(cur, end, &object, 0, arena, lazy, state);
+}
+
+bool Object::parse(std::istream& input, Object& object) {
+    object.reset();
+
+    if (!match("{", input)) {
+        return false;
+    }
+    if (match("}", input)) {
+        return true;
+    }
+
+    std::string key;
     do {
+        key.clear();
+        if (!parse_string(input, key)) {
+            if (Parser == Permissive) {
+                if (input.peek() == '}')
+                    break;
+            }
+            return false;
+        }
+        if (!match(":", input)) {
+            return false;
+        }
         Value* v = new Value();
         if (!parse_value(input, *v)) {
             delete v;
             break;
         }
-        array.values_.push_back(v);
+        Value*& slot = object.assign(key);
+        if (slot && !slot->arena_) delete slot;
+        slot = v;
     } while (match(",", input));
 
-    if (!match("]", input)) {
+
+    if (!match("}", input)) {
         return false;
     }
+
     return true;
 }
 
-static std::ostream& stream_string(std::ostream& stream,
-                                   const std::string& string) {
-    stream << '"';
-    for (std::string::const_iterator i = string.begin(),
-                 e = string.end(); i != e; ++i) {
-        switch (*i) {
-            case '"':
-                stream << "\\\"";
-                break;
-            case '\\':
-                stream << "\\\\";
-                break;
-            case '/':
-                stream << "\\/";
-                break;
-            case '\b':
-                stream << "\\b";
-                break;
-            case '\f':
-                stream << "\\f";
-                break;
-            case '\n':
-                stream << "\\n";
-                break;
-            case '\r':
-                stream << "\\r";
-                break;
-            case '\t':
-                stream << "\\t";
-                break;
-            default:
-                if (*i < 32) {
-                    stream << "\\u" << std::hex << std::setw(4) <<
-                            std::setfill('0') << static_cast<int>(*i) << std::dec <<
-                            std::setw(0);
-                } else {
-                    stream << *i;
-                }
+Value::Value() : type_(INVALID_), arena_(0) {}
+
+void Value::reset() {
+    if (type_ == STRING_) {
+        if (!arena_) delete string_value_;
+        string_value_ = 0;
+    }
+    else if (type_ == OBJECT_) {
+        if (!arena_) delete object_value_;
+        object_value_ = 0;
+    }
+    else if (type_ == ARRAY_) {
+        if (!arena_) delete array_value_;
+        array_value_ = 0;
+    }
+    else if (type_ == SHARED_) {
+        // the refcount block is heap-owned even inside an arena tree
+        Shared::unref(shared_value_);
+        shared_value_ = 0;
+    }
+}
+
+String *Value::make_string() {
+    JSONXX_STAT_ADD(nodes_created, 1);
+    return arena_ ? arena_->create<String>() : new String();
+}
+
+Array *Value::make_array() {
+    JSONXX_STAT_ADD(nodes_created, 1);
+    return arena_ ? arena_->create<Array>() : new Array();
+}
+
+Object *Value::make_object() {
+    JSONXX_STAT_ADD(nodes_created, 1);
+    return arena_ ? arena_->create<Object>() : new Object();
+}
+
+void Value::materialize() {
+    JSONXX_ASSERT(type_ == RAW_);
+    const char* cur = raw_value_.begin;
+    const char* end = raw_value_.end;
+    if (*cur == '{') {
+        Object* o = make_object();
+        if (Object::parse(cur, end, *o, arena_, true)) {
+            object_value_ = o;
+            type_ = OBJECT_;
+            return;
+        }
+        if (!arena_) delete o;
+    } else {
+        Array* a = make_array();
+        if (Array::parse(cur, end, *a, arena_, true)) {
+            array_value_ = a;
+            type_ = ARRAY_;
+            return;
+        }
+        if (!arena_) delete a;
+    }
+    // the skipper only balanced the braces; a slice can still turn out
+    // malformed here, in which case the value goes invalid rather than
+    // half-built
+    type_ = INVALID_;
+}
+
+void Value::detach() {
+    if (type_ != SHARED_) return;
+    Shared::Node* node = shared_value_;
+    shared_value_ = 0;
+    type_ = INVALID_;
+    // deep copy: the first mutation pays the one copy sharing saved.
+    // make_*() keeps honoring arena_, so a detach inside an arena tree
+    // carves its private copy out of the same arena.
+    import(node->value);
+    Shared::unref(node);
+}
+
+namespace {
+
+// Freeze-time walk: a snapshot may outlive any input buffer, so no lazy
+// slices survive in it. It also performs, once, the normalizations the
+// accessors otherwise do lazily in place -- SSTRING_ heap-materializes
+// to STRING_, INT_ widens to NUMBER_ -- so const reads of the frozen
+// tree never write to it and lock-free readers stay safe. long double
+// holds every int64 exactly and format_number keeps whole values on the
+// integer fast path, so serialization is byte-identical. The walk
+// drains through an explicit stack, like teardown and deep copy, so
+// deep snapshots freeze without recursing once per level.
+void materialize_tree(Value& root) {
+    std::vector<Value*> stack;
+    stack.push_back(&root);
+    while (!stack.empty()) {
+        Value& v = *stack.back();
+        stack.pop_back();
+        if (v.type_ == Value::RAW_) v.materialize();
+        if (v.type_ == Value::SSTRING_) {
+            String copy(v.sstring_data(), v.sstring_size());
+            ( v.string_value_ = new String() )->swap(copy);
+            v.type_ = Value::STRING_;
+        } else if (v.type_ == Value::INT_) {
+            long long i = v.int_value_;
+            v.number_value_ = (Number)(i);
+            v.type_ = Value::NUMBER_;
+        } else if (v.type_ == Value::OBJECT_) {
+            Object::ordering::const_iterator it = v.object_value_->kv_order().begin(),
+                end = v.object_value_->kv_order().end();
+            for (; it != end; ++it) stack.push_back((*it)->second);
+        } else if (v.type_ == Value::ARRAY_) {
+            Array::container::const_iterator it = v.array_value_->values().begin(),
+                end = v.array_value_->values().end();
+            for (; it != end; ++it) stack.push_back(*it);
+        }
+    }
+}
+
+}  // namespace
+
+Shared::Shared(const Value& snapshot) : node_(0) {
+    if (snapshot.type_ == Value::SHARED_) {   // already frozen: alias it
+        node_ = ref(snapshot.shared_value_);
+        return;
+    }
+    node_ = new Node();
+    node_->value.import(snapshot);
+    materialize_tree(node_->value);
+}
+
+Shared::Shared(const Object& snapshot) : node_(new Node()) {
+    node_->value.import(snapshot);
+    materialize_tree(node_->value);
+}
+
+Shared::Shared(const Array& snapshot) : node_(new Node()) {
+    node_->value.import(snapshot);
+    materialize_tree(node_->value);
+}
+
+bool Value::parse(const char*& cur, const char* end, Value& value, bool lazy, ParseState* state) {
+    JSONXX_STAT_PARSE_SCOPE(cur);
+    value.reset();
+
+    std::string string_value;
+    if (parse_string(cur, end, string_value, state)) {
+        if (string_value.size() <= (size_t)SSTRING_CAPACITY) {
+            value.set_sstring(string_value.data(), string_value.size());
+            value.type_ = SSTRING_;
+        } else {
+            value.string_value_ = value.make_string();
+            value.string_value_->swap(string_value);
+            value.type_ = STRING_;
+        }
+        return true;
+    }
+    if (parse_integer(cur, end, value.int_value_)) {
+        value.type_ = INT_;
+        return true;
+    }
+    if (parse_number(cur, end, value.number_value_)) {
+        value.type_ = NUMBER_;
+        return true;
+    }
+
+    if (parse_bool(cur, end, value.bool_value_)) {
+        value.type_ = BOOL_;
+        return true;
+    }
+    if (parse_null(cur, end)) {
+        value.type_ = NULL_;
+        return true;
+    }
+    if (lazy) {
+        skip_whitespace(cur, end);
+        if (cur < end && (*cur == '[' || *cur == '{')) {
+            const char* begin = cur;
+            if (skip_balanced(cur, end)) {
+                value.raw_value_.begin = begin;
+                value.raw_value_.end = cur;
+                value.type_ = RAW_;
+                return true;
+            }
+            cur = begin;  // unbalanced: let the eager path report failure
+        }
+    }
+    if (cur < end && *cur == '[') {
+        value.array_value_ = value.make_array();
+        if (parse_array(cur, end, *value.array_value_, value.arena_, false, state)) {
+            value.type_ = ARRAY_;
+            return true;
+        }
+        if (!value.arena_) delete value.array_value_;
+    }
+    value.object_value_ = value.make_object();
+    if (parse_object(cur, end, *value.object_value_, value.arena_, false, state)) {
+        value.type_ = OBJECT_;
+        return true;
+    }
+    if (!value.arena_) delete value.object_value_;
+    return false;
+}
+
+bool Value::parse(std::istream& input, Value& value) {
+    value.reset();
+
+    std::string string_value;
+    if (parse_string(input, string_value)) {
+        if (string_value.size() <= (size_t)SSTRING_CAPACITY) {
+            value.set_sstring(string_value.data(), string_value.size());
+            value.type_ = SSTRING_;
+        } else {
+            value.string_value_ = new std::string();
+            value.string_value_->swap(string_value);
+            value.type_ = STRING_;
+        }
+        return true;
+    }
+    if (parse_number(input, value.number_value_)) {
+        value.type_ = NUMBER_;
+        return true;
+    }
+
+    if (parse_bool(input, value.bool_value_)) {
+        value.type_ = BOOL_;
+        return true;
+    }
+    if (parse_null(input)) {
+        value.type_ = NULL_;
+        return true;
+    }
+    if (input.peek() == '[') {
+        value.array_value_ = new Array();
+        if (parse_array(input, *value.array_value_)) {
+            value.type_ = ARRAY_;
+            return true;
+        }
+        delete value.array_value_;
+    }
+    value.object_value_ = new Object();
+    if (parse_object(input, *value.object_value_)) {
+        value.type_ = OBJECT_;
+        return true;
+    }
+    delete value.object_value_;
+    return false;
+}
+
+Array::Array() : values_(), cache_(0) {}
+
+Array::~Array() {
+    reset();
+    delete cache_;
+}
+
+bool Array::parse(const char*& cur, const char* end, Array& array, Arena* arena, bool lazy, ParseState* state) {
+    JSONXX_STAT_PARSE_SCOPE(cur);
+    return parse_iterative(cur, end, 0, &array, arena, lazy, state);
+}
+
+bool Array::parse(std::istream& input, Array& array) {
+    array.reset();
+
+    if (!match("[", input)) {
+        return false;
+    }
+    if (match("]", input)) {
+        return true;
+    }
+
+    do {
+        Value* v = new Value();
+        if (!parse_value(input, *v)) {
+            delete v;
+            break;
         }
+        array.values_.push_back(v);
+    } while (match(",", input));
+
+    if (!match("]", input)) {
+        return false;
     }
-    stream << '"';
-    return stream;
+    return true;
 }
 
 }  // namespace jsonxx
 
+// All three operators route through the streaming serializer in compact
+// mode, so iostream output uses the same escaper as json().
 std::ostream& operator<<(std::ostream& stream, const jsonxx::Value& v) {
-    using namespace jsonxx;
-    if (v.is<Number>()) {
-        return stream << v.get<Number>();
-    } else if (v.is<String>()) {
-        return stream_string(stream, v.get<std::string>());
-    } else if (v.is<Boolean>()) {
-        if (v.get<Boolean>()) {
-            return stream << "true";
-        } else {
-            return stream << "false";
-        }
-    } else if (v.is<Null>()) {
-        return stream << "null";
-    } else if (v.is<Object>()) {
-        return stream << v.get<Object>();
-    } else if (v.is<Array>()){
-        return stream << v.get<Array>();
-    }
-    // Shouldn't reach here.
+    jsonxx::StreamSink sink( stream );
+    v.json( sink, false );
     return stream;
 }
 
 std::ostream& operator<<(std::ostream& stream, const jsonxx::Array& v) {
-    stream << "[";
-    jsonxx::Array::container::const_iterator
-        it = v.values().begin(),
-        end = v.values().end();
-    while (it != end) {
-        stream << *(*it);
-        ++it;
-        if (it != end) {
-            stream << ", ";
-        }
-    }
-    return stream << "]";
+    jsonxx::StreamSink sink( stream );
+    v.json( sink, false );
+    return stream;
 }
 
 std::ostream& operator<<(std::ostream& stream, const jsonxx::Object& v) {
-    stream << "{";
-    jsonxx::Object::container::const_iterator
-        it = v.kv_map().begin(),
-        end = v.kv_map().end();
-    while (it != end) {
-        jsonxx::stream_string(stream, it->first);
-        stream << ": " << *(it->second);
-        ++it;
-        if (it != end) {
-            stream << ", ";
-        }
-    }
-    return stream << "}";
+    jsonxx::StreamSink sink( stream );
+    v.json( sink, false );
+    return stream;
 }
 
 
@@ -461,6 +1806,7 @@ typedef unsigned char byte;
 
 //template<bool quote>
 std::string escape_string( const std::string &input, const bool quote = false ) {
+    JSONXX_STAT_ADD(escaped_bytes, input.size());
     static std::string map[256], *once = 0;
     if( !once ) {
         // base
@@ -488,68 +1834,226 @@ std::string escape_string( const std::string &input, const bool quote = false )
     std::string output;
     output.reserve( input.size() * 2 + 2 ); // worst scenario
     if( quote ) output += '"';
-    for( std::string::const_iterator it = input.begin(), end = input.end(); it != end; ++it )
-        output += map[ byte(*it) ];
+    const char *cur = input.data(), *end = cur + input.size();
+    while( cur < end ) {
+        const char *run = scan_escape_run( cur, end );
+        if( run > cur ) {
+            output.append( cur, run );  // bulk-copy the clean run
+            cur = run;
+            if( cur >= end ) break;
+        }
+        output += map[ byte(*cur++) ];
+    }
     if( quote ) output += '"';
     return output;
 }
 
 
-namespace json {
+void format_integer( std::string &out, const long long &i ) {
+    char buffer[24];
+    int size = snprintf( buffer, sizeof(buffer), "%lld", i );
+    out.append( buffer, size );
+}
 
-    std::string remove_last_comma( const std::string &_input ) {
-        std::string input( _input );
-        size_t size = input.size();
-        if( size > 2 )
-            if( input[ size - 2 ] == ',' )
-                input[ size - 2 ] = ' ';
-        return input;
+// Format a Number straight into the output buffer at the same maximum
+// precision the iostream path used (%.19Lg), without locale or stream
+// machinery. Whole values in 64-bit range take an integer fast path so
+// counters and IDs don't pay long-double formatting.
+void format_number( std::string &out, const jsonxx::Number &n ) {
+    if( n >= (jsonxx::Number)(LLONG_MIN) && n <= (jsonxx::Number)(LLONG_MAX) ) {
+        long long i = (long long)(n);
+        if( (jsonxx::Number)(i) == n && !( i == 0 && 1.0L / n < 0 ) ) {
+            format_integer( out, i );
+            return;
+        }
     }
+    char buffer[64];
+    int size = snprintf( buffer, sizeof(buffer), "%.*Lg",
+            std::numeric_limits<long double>::digits10 + 1, n );
+    out.append( buffer, size );
+}
 
-    std::string tag( unsigned format, unsigned depth, const std::string &name, const jsonxx::Value &t) {
-        std::stringstream ss;
-        const std::string tab(depth, '\t');
+namespace json {
+
+    // One suspended container of the iterative serializer: exactly one
+    // of object/array is set, 'index' is the next child to emit, 'depth'
+    // is the container's own indentation level.
+    struct WriteFrame {
+        const jsonxx::Object *object;
+        const jsonxx::Array *array;
+        size_t index;
+        unsigned depth;
+    };
+
+    bool stream_name( jsonxx::Sink &out, unsigned depth, const std::string *name, bool pretty ) {
+        if( pretty )
+            for( unsigned i = 0; i < depth; ++i )
+                if( !out.put('\t') )
+                    return false;
+        if( name && !name->empty() ) {
+            if( !out.put('\"') || !out.write(escape_string(*name)) || !out.write("\": ", 3) )
+                return false;
+        }
+        return true;
+    }
 
-        if( !name.empty() )
-            ss << tab << '\"' << escape_string( name ) << '\"' << ':' << ' ';
-        else
-            ss << tab;
+    bool stream_tree( jsonxx::Sink &out, unsigned depth, const std::string *name, const jsonxx::Value &root, bool pretty, bool prologue );
+
+    // Emit one node: scalars completely, containers just their opener --
+    // a pushed frame hands the children back to the driving loop below.
+    // A container with a clean matching JsonCache is spliced in as bytes
+    // instead; a dirty one is re-rendered into its cache first (through
+    // stream_tree, so one C-stack level per *nested* opted-in cache).
+    // 'prologue' false skips the indentation/name prefix -- cached bytes
+    // start at the opening brace so one snapshot serves json() and the
+    // parent walk alike.
+    bool stream_node( jsonxx::Sink &out, unsigned depth, const std::string *name, const jsonxx::Value &t, bool pretty, std::vector<WriteFrame> &frames, bool prologue, bool use_cache ) {
+        // lazy slices parse in place first, then serialize like any node
+        if( t.type_ == jsonxx::Value::RAW_ )
+            const_cast<jsonxx::Value &>(t).materialize();
+
+        // a shared payload serializes as the frozen tree it points at
+        if( t.type_ == jsonxx::Value::SHARED_ )
+            return stream_node( out, depth, name, t.deref(), pretty, frames, prologue, use_cache );
+
+        if( prologue && !stream_name( out, depth, name, pretty ) )
+            return false;
 
         switch( t.type_ )
         {
             default:
             case jsonxx::Value::NULL_:
-                ss << "null";
-                return ss.str() + ",\n";
+                return out.write( "null", 4 );
 
             case jsonxx::Value::BOOL_:
-                ss << ( t.bool_value_ ? "true" : "false" );
-                return ss.str() + ",\n";
-
-            case jsonxx::Value::ARRAY_:
-                ss << "[\n";
-                for(Array::container::const_iterator it = t.array_value_->values().begin(),
-                    end = t.array_value_->values().end(); it != end; ++it )
-                  ss << tag( format, depth+1, std::string(), **it );
-                return remove_last_comma( ss.str() ) + tab + "]" ",\n";
+                return t.bool_value_ ? out.write( "true", 4 ) : out.write( "false", 5 );
 
             case jsonxx::Value::STRING_:
-                ss << '\"' << escape_string( *t.string_value_ ) << '\"';
-                return ss.str() + ",\n";
+                return out.put('\"') && out.write( escape_string( *t.string_value_ ) ) && out.put('\"');
 
-            case jsonxx::Value::OBJECT_:
-                ss << "{\n";
-                for(Object::container::const_iterator it=t.object_value_->kv_map().begin(),
-                    end = t.object_value_->kv_map().end(); it != end ; ++it)
-                  ss << tag( format, depth+1, it->first, *it->second );
-                return remove_last_comma( ss.str() ) + tab + "}" ",\n";
+            case jsonxx::Value::SSTRING_:
+                return out.put('\"')
+                    && out.write( escape_string( std::string(t.sstring_data(), t.sstring_size()) ) )
+                    && out.put('\"');
 
-            case jsonxx::Value::NUMBER_:
+            case jsonxx::Value::NUMBER_: {
+                std::string text;
                 // max precision
-                ss << std::setprecision(std::numeric_limits<long double>::digits10 + 1);
-                ss << t.number_value_;
-                return ss.str() + ",\n";
+                format_number( text, t.number_value_ );
+                return out.write( text );
+            }
+
+            case jsonxx::Value::INT_: {
+                std::string text;
+                format_integer( text, t.int_value_ );
+                return out.write( text );
+            }
+
+            case jsonxx::Value::ARRAY_:
+            case jsonxx::Value::OBJECT_: {
+                WriteFrame f;
+                f.object = t.type_ == jsonxx::Value::OBJECT_ ? t.object_value_ : 0;
+                f.array = t.type_ == jsonxx::Value::ARRAY_ ? t.array_value_ : 0;
+                f.index = 0;
+                f.depth = depth;
+                jsonxx::JsonCache *cache = use_cache
+                    ? ( f.object ? f.object->json_cache() : f.array->json_cache() )
+                    : 0;
+                if( cache ) {
+                    if( !( cache->valid && cache->pretty == pretty && cache->depth == depth ) ) {
+                        cache->bytes.clear();
+                        jsonxx::StringSink fill( cache->bytes );
+                        if( !stream_tree( fill, depth, 0, t, pretty, false ) || !fill.flush() )
+                            return false;
+                        cache->valid = true;
+                        cache->pretty = pretty;
+                        cache->depth = depth;
+                    }
+                    return out.write( cache->bytes );
+                }
+                if( !out.put( f.object ? '{' : '[' ) || ( pretty && !out.put('\n') ) )
+                    return false;
+                frames.push_back( f );
+                return true;
+            }
+        }
+    }
+
+    // Iterative serializer, writing to a Sink with nesting held in an
+    // explicit stack so arbitrarily deep documents don't consume thread
+    // stack. Separators are deferred to the owning frame, which emits
+    // ",\n" between children and " \n" after the last one — the same
+    // bytes the old blank-the-last-comma post-pass produced — so pretty
+    // output matches the historical buffered serializer exactly. Compact
+    // mode emits the ", " and ": " separators operator<< always used,
+    // through the same escaper.
+    bool stream_tree( jsonxx::Sink &out, unsigned depth, const std::string *name, const jsonxx::Value &root, bool pretty, bool prologue ) {
+        JSONXX_STAT_JSON_SCOPE();
+        std::vector<WriteFrame> frames;
+
+        // the root never consults its own cache here (its json() entry
+        // points do that), or a cache fill would recurse into itself
+        if( !stream_node( out, depth, name, root, pretty, frames, prologue, false ) )
+            return false;
+
+        while( !frames.empty() ) {
+            WriteFrame &f = frames.back();
+            size_t n = f.object ? f.object->kv_order().size() : f.array->values().size();
+
+            if( f.index == n ) {
+                // close this container, then separate it inside its parent
+                if( pretty )
+                    for( unsigned i = 0; i < f.depth; ++i )
+                        if( !out.put('\t') )
+                            return false;
+                if( !out.put( f.object ? '}' : ']' ) )
+                    return false;
+                frames.pop_back();
+                if( frames.empty() )
+                    break;
+                WriteFrame &parent = frames.back();
+                size_t pn = parent.object ? parent.object->kv_order().size() : parent.array->values().size();
+                bool last = parent.index == pn;
+                if( pretty ) {
+                    if( !out.write( last ? " \n" : ",\n", 2 ) )
+                        return false;
+                } else if( !last && !out.write( ", ", 2 ) ) {
+                    return false;
+                }
+                continue;
+            }
+
+            size_t i = f.index++;
+            const jsonxx::Value *child;
+            const std::string *child_name = 0;
+            if( f.object ) {
+                const Object::ordering &order = f.object->kv_order();
+                child_name = &order[i]->first;
+                child = order[i]->second;
+            } else {
+                child = f.array->values()[i];
+            }
+
+            size_t before = frames.size();
+            if( !stream_node( out, f.depth + 1, child_name, *child, pretty, frames, true, true ) )
+                return false;
+            // 'f' may dangle past this point; a scalar child (no frame
+            // pushed) gets its separator right away, a container child
+            // gets it when its frame pops above
+            if( frames.size() == before ) {
+                if( pretty ) {
+                    if( !out.write( i + 1 < n ? ",\n" : " \n", 2 ) )
+                        return false;
+                } else if( i + 1 < n && !out.write( ", ", 2 ) ) {
+                    return false;
+                }
+            }
         }
+        return true;
+    }
+
+    bool stream_tag( jsonxx::Sink &out, unsigned depth, const std::string &name, const jsonxx::Value &root, bool pretty ) {
+        return stream_tree( out, depth, &name, root, pretty, true );
     }
 } // namespace jsonxx::anon::json
 
@@ -724,21 +2228,47 @@ std::string tag( unsigned format, unsigned depth, const std::string &name, const
                        + ss.str()
                        + close_tag( format, 's', name ) + '\n';
 
+        case jsonxx::Value::SSTRING_:
+            ss << escape_tag( std::string(t.sstring_data(), t.sstring_size()), format );
+            return tab + open_tag( format, 's', name, std::string(), format == jsonxx::JXMLex ? ss.str() : std::string() )
+                       + ss.str()
+                       + close_tag( format, 's', name ) + '\n';
+
+        case jsonxx::Value::RAW_: {
+            // lazy slice: parse it now, then serialize normally
+            jsonxx::Value &writable = const_cast<jsonxx::Value &>(t);
+            writable.materialize();
+            return tag( format, depth, name, writable, attr );
+        }
+
+        case jsonxx::Value::SHARED_:
+            // shared payload: serialize the frozen tree it points at
+            return tag( format, depth, name, t.deref(), attr );
+
         case jsonxx::Value::OBJECT_:
-            for(Object::container::const_iterator it=t.object_value_->kv_map().begin(),
-                end = t.object_value_->kv_map().end(); it != end ; ++it)
-              ss << tag( format, depth+1, it->first, *it->second );
+            for(Object::ordering::const_iterator it=t.object_value_->kv_order().begin(),
+                end = t.object_value_->kv_order().end(); it != end ; ++it)
+              ss << tag( format, depth+1, (*it)->first, *(*it)->second );
             return tab + open_tag( format, 'o', name, attr ) + '\n'
                        + ss.str()
                  + tab + close_tag( format, 'o', name ) + '\n';
 
-        case jsonxx::Value::NUMBER_:
+        case jsonxx::Value::NUMBER_: {
             // max precision
-            ss << std::setprecision(std::numeric_limits<long double>::digits10 + 1);
-            ss << t.number_value_;
-            return tab + open_tag( format, 'n', name, std::string(), format == jsonxx::JXMLex ? ss.str() : std::string() )
-                       + ss.str()
+            std::string text;
+            format_number( text, t.number_value_ );
+            return tab + open_tag( format, 'n', name, std::string(), format == jsonxx::JXMLex ? text : std::string() )
+                       + text
+                       + close_tag( format, 'n', name ) + '\n';
+        }
+
+        case jsonxx::Value::INT_: {
+            std::string text;
+            format_integer( text, t.int_value_ );
+            return tab + open_tag( format, 'n', name, std::string(), format == jsonxx::JXMLex ? text : std::string() )
+                       + text
                        + close_tag( format, 'n', name ) + '\n';
+        }
     }
 }
 
@@ -778,88 +2308,670 @@ const char *defrootattrib[] = {
 
 } // namespace jsonxx::anon
 
+bool Sink::write(const char *data, size_t size) {
+    if( size >= (size_t)BUFFER_SIZE )   // big writes bypass the buffer
+        return flush() && write_bytes( data, size );
+    if( used_ + size > (size_t)BUFFER_SIZE && !flush() )
+        return false;
+    memcpy( buffer_ + used_, data, size );
+    used_ += size;
+    return true;
+}
+
+bool Sink::put(char ch) {
+    if( used_ >= (size_t)BUFFER_SIZE && !flush() )
+        return false;
+    buffer_[used_++] = ch;
+    return true;
+}
+
+bool Sink::flush() {
+    if( !used_ )
+        return true;
+    size_t size = used_;
+    used_ = 0;
+    return write_bytes( buffer_, size );
+}
+
+bool StreamSink::write_bytes(const char *data, size_t size) {
+    return !!out_.write( data, size );
+}
+
+bool FileSink::write_bytes(const char *data, size_t size) {
+    return std::fwrite( data, 1, size, file_ ) == size;
+}
+
+bool FdSink::write_bytes(const char *data, size_t size) {
+    while( size ) {
+#if defined(_WIN32)
+        int written = _write( fd_, data, (unsigned)size );
+#else
+        ssize_t written = ::write( fd_, data, size );
+#endif
+        if( written <= 0 )
+            return false;
+        data += written;
+        size -= (size_t)written;
+    }
+    return true;
+}
+
+bool StringSink::write_bytes(const char *data, size_t size) {
+    out_.append( data, size );
+    return true;
+}
+
 std::string Object::json() const {
+    std::string result;
+    json( result );
+    return result;
+}
+
+void Object::json( std::string &out ) const {
+    // same iterative engine as the Sink overload; a StringSink never fails
+    StringSink sink( out );
+    json( sink );
+}
+
+void Object::json( std::ostream &out ) const {
+    StreamSink sink( out );
+    json( sink );
+}
+
+bool Object::json( Sink &out, bool pretty ) const {
     using namespace json;
 
     jsonxx::Value v;
     v.object_value_ = const_cast<jsonxx::Object*>(this);
     v.type_ = jsonxx::Value::OBJECT_;
 
-    std::string result = tag( jsonxx::JSON, 0, std::string(), v );
+    bool ok = true;
+    if( cache_ ) {
+        // opt-in fast path: unchanged nodes replay their last bytes
+        if( !( cache_->valid && cache_->pretty == pretty && cache_->depth == 0 ) ) {
+            cache_->bytes.clear();
+            StringSink fill( cache_->bytes );
+            ok = stream_tree( fill, 0, 0, v, pretty, false ) && fill.flush();
+            if( ok ) {
+                cache_->valid = true;
+                cache_->pretty = pretty;
+                cache_->depth = 0;
+            }
+        }
+        if( ok )
+            ok = out.write( cache_->bytes );
+    } else {
+        ok = stream_tag( out, 0, std::string(), v, pretty );
+    }
+    if( ok && pretty )
+        ok = out.write( " \n", 2 );   // same root trailer blank_last_comma left
+    if( ok )
+        ok = out.flush();
+
+    v.object_value_ = 0;
+    return ok;
+}
+
+std::string Object::xml( unsigned format, const std::string &header, const std::string &attrib ) const {
+    using namespace xml;
+    JSONXX_ASSERT( format == jsonxx::JSONx || format == jsonxx::JXML || format == jsonxx::JXMLex || format == jsonxx::TaggedXML );
+
+    jsonxx::Value v;
+    v.object_value_ = const_cast<jsonxx::Object*>(this);
+    v.type_ = jsonxx::Value::OBJECT_;
+
+    std::string result = tag( format, 0, std::string(), v, attrib.empty() ? std::string(defrootattrib[format]) : attrib );
+
+    v.object_value_ = 0;
+    return ( header.empty() ? std::string(defheader[format]) : header ) + result;
+}
+
+std::string Array::json() const {
+    std::string result;
+    json( result );
+    return result;
+}
+
+void Array::json( std::string &out ) const {
+    // same iterative engine as the Sink overload; a StringSink never fails
+    StringSink sink( out );
+    json( sink );
+}
+
+void Array::json( std::ostream &out ) const {
+    StreamSink sink( out );
+    json( sink );
+}
+
+bool Array::json( Sink &out, bool pretty ) const {
+    using namespace json;
+
+    jsonxx::Value v;
+    v.array_value_ = const_cast<jsonxx::Array*>(this);
+    v.type_ = jsonxx::Value::ARRAY_;
+
+    bool ok = true;
+    if( cache_ ) {
+        // opt-in fast path: unchanged nodes replay their last bytes
+        if( !( cache_->valid && cache_->pretty == pretty && cache_->depth == 0 ) ) {
+            cache_->bytes.clear();
+            StringSink fill( cache_->bytes );
+            ok = stream_tree( fill, 0, 0, v, pretty, false ) && fill.flush();
+            if( ok ) {
+                cache_->valid = true;
+                cache_->pretty = pretty;
+                cache_->depth = 0;
+            }
+        }
+        if( ok )
+            ok = out.write( cache_->bytes );
+    } else {
+        ok = stream_tag( out, 0, std::string(), v, pretty );
+    }
+    if( ok && pretty )
+        ok = out.write( " \n", 2 );
+    if( ok )
+        ok = out.flush();
+
+    v.array_value_ = 0;
+    return ok;
+}
+
+bool Value::json( Sink &out, bool pretty ) const {
+    using namespace json;
+    bool ok = stream_tag( out, 0, std::string(), *this, pretty );
+    if( ok && pretty )
+        ok = out.write( " \n", 2 );
+    return ok && out.flush();
+}
+
+std::string Array::xml( unsigned format, const std::string &header, const std::string &attrib ) const {
+    using namespace xml;
+    JSONXX_ASSERT( format == jsonxx::JSONx || format == jsonxx::JXML || format == jsonxx::JXMLex || format == jsonxx::TaggedXML );
+
+    jsonxx::Value v;
+    v.array_value_ = const_cast<jsonxx::Array*>(this);
+    v.type_ = jsonxx::Value::ARRAY_;
+
+    std::string result = tag( format, 0, std::string(), v, attrib.empty() ? std::string(defrootattrib[format]) : attrib );
+
+    v.array_value_ = 0;
+    return ( header.empty() ? std::string(defheader[format]) : header ) + result;
+}
+
+namespace {
+
+// Validating walker: the same grammar as the DOM and event parsers above,
+// sharing their tokenizer, but it builds nothing. Nesting state lives in
+// an explicit stack at one byte per open container, so validate()
+// tolerates the same depths as the iterative parser instead of capping
+// at what the thread stack allows.
+
+bool skip_scalar_token(const char*& cur, const char* end) {
+    if (skip_string(cur, end)) {
+        return true;
+    }
+    skip_whitespace(cur, end);
+    if (const char* p = scan_number_token(cur, end)) {
+        cur = p;
+        return true;
+    }
+    Boolean bool_value;
+    if (parse_bool(cur, end, bool_value)) {
+        return true;
+    }
+    return parse_null(cur, end);
+}
+
+bool skip_container_token(const char*& cur, const char* end) {
+    // Modes mirror parse_iterative: OPEN enters the container under the
+    // cursor, ELEMENT consumes one member, NEXT looks for the separator,
+    // CLOSE matches the closer and pops. A failed member falls through
+    // to CLOSE on the enclosing frame, preserving the permissive
+    // recovery of the recursive walker this replaces.
+    enum { OPEN, ELEMENT, NEXT, CLOSE } mode = OPEN;
+    std::string closers;   // one byte per open container
+
+    for (;;) {
+        if (mode == OPEN) {
+            bool object = !(cur < end && *cur == '[');
+            if (!match(object ? "{" : "[", cur, end)) {
+                // no value where one was required: let the enclosing
+                // container try to close over it
+                if (closers.empty())
+                    return false;
+                mode = CLOSE;
+            } else if (match(object ? "}" : "]", cur, end)) {
+                if (closers.empty())
+                    return true;
+                mode = NEXT;
+            } else {
+                closers += object ? '}' : ']';
+                mode = ELEMENT;
+            }
+        } else if (mode == ELEMENT) {
+            if (closers[closers.size() - 1] == '}') {
+                if (!skip_string(cur, end)) {
+                    if (Parser == Permissive && cur < end && *cur == '}') {
+                        mode = CLOSE;
+                        continue;
+                    }
+                    // malformed key: this frame fails without trying its
+                    // closer, and the parent falls through to CLOSE
+                    closers.erase(closers.size() - 1);
+                    if (closers.empty())
+                        return false;
+                    mode = CLOSE;
+                    continue;
+                }
+                if (!match(":", cur, end)) {
+                    closers.erase(closers.size() - 1);
+                    if (closers.empty())
+                        return false;
+                    mode = CLOSE;
+                    continue;
+                }
+            }
+            mode = skip_scalar_token(cur, end) ? NEXT : OPEN;
+        } else if (mode == NEXT) {
+            mode = match(",", cur, end) ? ELEMENT : CLOSE;
+        } else { // CLOSE
+            char closer = closers[closers.size() - 1];
+            closers.erase(closers.size() - 1);
+            bool closed = match(closer == '}' ? "}" : "]", cur, end);
+            if (closers.empty())
+                return closed;
+            mode = closed ? NEXT : CLOSE;
+        }
+    }
+}
+
+} // namespace jsonxx::anon
+
+bool validate( const char *begin, const char *end ) {
+    const char *cur = begin;
+    skip_whitespace( cur, end );
+    while( parse_comment( cur, end ) )
+        ;
+
+    // like the DOM entry points, only a top-level object or array counts
+    if( cur < end && ( *cur == '{' || *cur == '[' ) )
+        return skip_container_token( cur, end );
+    return false;
+}
+
+bool validate( const char *data, size_t size ) {
+    return jsonxx::validate( data, data + size );
+}
+
+bool validate( const std::string &input ) {
+    return jsonxx::validate( input.data(), input.data() + input.size() );
+}
+
+bool validate( std::istream &input ) {
+    std::ostringstream ss;
+    ss << input.rdbuf();
+    const std::string &buffer = ss.str();
+    return jsonxx::validate( buffer.data(), buffer.data() + buffer.size() );
+}
+
+// Frame stack the iterative engine borrows for every parse through this
+// Reader; its capacity survives between documents.
+struct Reader::Scratch {
+    std::vector<ParseFrame> frames;
+};
+
+Reader::Reader( const ParseOptions &options ) : options_( options ), scratch_( new Scratch() ) {}
+
+Reader::~Reader() {
+    delete scratch_;
+}
+
+bool Reader::parse( const std::string &input, Object &out ) {
+    return parse( input.data(), input.data() + input.size(), out );
+}
+
+bool Reader::parse( const char *begin, const char *end, Object &out ) {
+    if( options_.max_bytes && size_t(end - begin) > options_.max_bytes )
+        return false;
+    ParseState state( options_ );
+    state.frames = &scratch_->frames;
+    const char *cur = begin;
+    return Object::parse( cur, end, out, &arena_, false, &state ) && !state.exceeded;
+}
+
+bool Reader::parse( const std::string &input, Array &out ) {
+    return parse( input.data(), input.data() + input.size(), out );
+}
+
+bool Reader::parse( const char *begin, const char *end, Array &out ) {
+    if( options_.max_bytes && size_t(end - begin) > options_.max_bytes )
+        return false;
+    ParseState state( options_ );
+    state.frames = &scratch_->frames;
+    const char *cur = begin;
+    return Array::parse( cur, end, out, &arena_, false, &state ) && !state.exceeded;
+}
+
+bool Reader::parse( const std::string &input, Value &out ) {
+    return parse( input.data(), input.data() + input.size(), out );
+}
+
+bool Reader::parse( const char *begin, const char *end, Value &out ) {
+    if( options_.max_bytes && size_t(end - begin) > options_.max_bytes )
+        return false;
+    out.reset();
+    out.arena_ = &arena_;
+    ParseState state( options_ );
+    state.frames = &scratch_->frames;
+    const char *cur = begin;
+    return Value::parse( cur, end, out, false, &state ) && !state.exceeded;
+}
+
+void Reader::clear() {
+    arena_.clear();
+}
+
+const std::string &Writer::json( const Object &object ) {
+    buffer_.clear();
+    object.json( buffer_ );
+    return buffer_;
+}
+
+const std::string &Writer::json( const Array &array ) {
+    buffer_.clear();
+    array.json( buffer_ );
+    return buffer_;
+}
+
+namespace {
+
+struct line_span {
+    const char *begin;
+    const char *end;
+};
+
+// Collect the non-blank lines of a newline-delimited batch.
+void split_lines( const char *data, size_t size, std::vector<line_span> &lines ) {
+    const char *cur = data;
+    const char *end = data + size;
+    while( cur < end ) {
+        const char *eol = static_cast<const char*>( memchr( cur, '\n', end - cur ) );
+        if( eol == 0 ) eol = end;
+        const char *begin = cur;
+        while( begin < eol && static_cast<unsigned char>(*begin) <= 32 ) ++begin;
+        if( begin < eol ) {
+            line_span span = { begin, eol };
+            lines.push_back( span );
+        }
+        cur = eol + 1;
+    }
+}
+
+bool parse_lines( const std::vector<line_span> &lines, size_t begin, size_t end, std::vector<Object> &out ) {
+    bool ok = true;
+    for( size_t i = begin; i < end; ++i ) {
+        if( !out[i].parse( lines[i].begin, lines[i].end ) ) ok = false;
+    }
+    return ok;
+}
+
+}  // namespace
+
+bool parse_many( const char *data, size_t size, std::vector<Object> &out, unsigned threads ) {
+    std::vector<line_span> lines;
+    split_lines( data, size, lines );
+
+    out.clear();
+    out.resize( lines.size() );
+
+#if JSONXX_COMPILER_HAS_CXX11 > 0
+    if( threads == 0 ) threads = std::thread::hardware_concurrency();
+    if( threads > lines.size() ) threads = static_cast<unsigned>( lines.size() );
+    if( threads > 1 ) {
+        // Hand out lines one at a time so a batch of uneven documents
+        // keeps every worker busy; each line writes its own slot in 'out'.
+        std::atomic<size_t> next( 0 );
+        std::atomic<bool> ok( true );
+        std::vector<std::thread> pool;
+        for( unsigned t = 0; t < threads; ++t ) {
+            pool.push_back( std::thread( [&]() {
+                for( ;; ) {
+                    size_t i = next.fetch_add( 1 );
+                    if( i >= lines.size() ) break;
+                    if( !parse_lines( lines, i, i + 1, out ) ) ok = false;
+                }
+            } ) );
+        }
+        for( unsigned t = 0; t < threads; ++t ) pool[t].join();
+        return ok;
+    }
+#else
+    (void)threads;
+#endif
+
+    return parse_lines( lines, 0, lines.size(), out );
+}
+
+bool parse_many( const std::string &input, std::vector<Object> &out, unsigned threads ) {
+    return parse_many( input.data(), input.size(), out, threads );
+}
+
+namespace {
+
+// Streaming transcoders: ParseHandlers that pipe the event tokenizer
+// straight into a Sink. A transcode touches the input bytes plus one
+// flag or name per open container, instead of a DOM and two text
+// buffers, and the writers reproduce the DOM serializers byte for byte.
+
+struct StreamJsonWriter : public ParseHandler {
+    StreamJsonWriter( Sink &out, bool pretty )
+        : out_(&out), pretty_(pretty), ok_(true), have_key_(false) {}
+
+    Sink *out_;
+    bool pretty_;
+    bool ok_;             // sticky: a failed write aborts the walk
+    bool have_key_;
+    std::string key_;
+    // one flag per open container: no separator before the first child
+    std::vector<bool> first_;
+
+    // the separator owed by the previous sibling, the indentation, then
+    // the pending key -- the same bytes stream_tree defers to the frame
+    bool prologue() {
+        if( !first_.empty() ) {
+            if( !first_.back() && !out_->write( pretty_ ? ",\n" : ", ", 2 ) )
+                return false;
+            first_.back() = false;
+        }
+        const std::string *name = have_key_ ? &key_ : 0;
+        have_key_ = false;
+        return json::stream_name( *out_, (unsigned)first_.size(), name, pretty_ );
+    }
+
+    bool open( char ch ) {
+        ok_ = ok_ && prologue() && out_->put( ch ) && ( !pretty_ || out_->put('\n') );
+        first_.push_back( true );
+        return ok_;
+    }
+
+    bool close( char ch ) {
+        bool had_children = !first_.back();
+        first_.pop_back();
+        if( ok_ && pretty_ ) {
+            if( had_children && !out_->write( " \n", 2 ) )
+                return ok_ = false;
+            for( size_t i = 0; i < first_.size(); ++i )
+                if( !out_->put('\t') )
+                    return ok_ = false;
+        }
+        return ok_ = ok_ && out_->put( ch );
+    }
+
+    virtual bool key( const String &name ) {
+        key_ = name;
+        have_key_ = true;
+        return true;
+    }
+    virtual bool begin_object() { return open( '{' ); }
+    virtual bool end_object() { return close( '}' ); }
+    virtual bool begin_array() { return open( '[' ); }
+    virtual bool end_array() { return close( ']' ); }
+    virtual bool string( const String &value ) {
+        ok_ = ok_ && prologue() && out_->put('\"')
+            && out_->write( escape_string( value ) ) && out_->put('\"');
+        return ok_;
+    }
+    virtual bool number( Number value ) {
+        std::string text;
+        format_number( text, value );
+        return ok_ = ok_ && prologue() && out_->write( text );
+    }
+    virtual bool integer( Integer value ) {
+        std::string text;
+        format_integer( text, value );
+        return ok_ = ok_ && prologue() && out_->write( text );
+    }
+    virtual bool boolean( Boolean value ) {
+        return ok_ = ok_ && prologue()
+            && ( value ? out_->write( "true", 4 ) : out_->write( "false", 5 ) );
+    }
+    virtual bool null() {
+        return ok_ = ok_ && prologue() && out_->write( "null", 4 );
+    }
+};
 
-    v.object_value_ = 0;
-    return remove_last_comma( result );
-}
+struct StreamXmlWriter : public ParseHandler {
+    StreamXmlWriter( Sink &out, unsigned format, const std::string &attrib )
+        : out_(&out), format_(format), attrib_(attrib), ok_(true), have_key_(false) {}
+
+    Sink *out_;
+    unsigned format_;
+    std::string attrib_;   // root-container attributes (JSONx schema etc)
+    bool ok_;
+    bool have_key_;
+    std::string key_;
+    // close_tag needs the name and kind back, so each open container
+    // parks them here
+    struct Level { std::string name; char type; };
+    std::vector<Level> levels_;
+
+    bool tabs() {
+        for( size_t i = 0; i < levels_.size(); ++i )
+            if( !out_->put('\t') )
+                return false;
+        return true;
+    }
+    std::string take_key() {
+        std::string name;
+        if( have_key_ ) {
+            name.swap( key_ );
+            have_key_ = false;
+        }
+        return name;
+    }
 
-std::string Object::xml( unsigned format, const std::string &header, const std::string &attrib ) const {
-    using namespace xml;
-    JSONXX_ASSERT( format == jsonxx::JSONx || format == jsonxx::JXML || format == jsonxx::JXMLex || format == jsonxx::TaggedXML );
+    bool container( char type ) {
+        Level level;
+        level.name = take_key();
+        level.type = type;
+        const std::string attr = levels_.empty() ? attrib_ : std::string();
+        ok_ = ok_ && tabs()
+            && out_->write( xml::open_tag( format_, type, level.name, attr ) )
+            && out_->put('\n');
+        levels_.push_back( level );
+        return ok_;
+    }
+    bool close() {
+        Level level = levels_.back();
+        levels_.pop_back();
+        ok_ = ok_ && tabs()
+            && out_->write( xml::close_tag( format_, level.type, level.name ) )
+            && out_->put('\n');
+        return ok_;
+    }
+    // 'text' arrives pre-escaped where the format needs it, matching the
+    // DOM walker: strings through escape_tag, numbers/booleans verbatim
+    bool scalar( char type, const std::string &text ) {
+        const std::string name = take_key();
+        ok_ = ok_ && tabs()
+            && out_->write( xml::open_tag( format_, type, name, std::string(),
+                                           format_ == JXMLex ? text : std::string() ) )
+            && out_->write( text )
+            && out_->write( xml::close_tag( format_, type, name ) )
+            && out_->put('\n');
+        return ok_;
+    }
 
-    jsonxx::Value v;
-    v.object_value_ = const_cast<jsonxx::Object*>(this);
-    v.type_ = jsonxx::Value::OBJECT_;
+    virtual bool key( const String &name ) {
+        key_ = name;
+        have_key_ = true;
+        return true;
+    }
+    virtual bool begin_object() { return container( 'o' ); }
+    virtual bool end_object() { return close(); }
+    virtual bool begin_array() { return container( 'a' ); }
+    virtual bool end_array() { return close(); }
+    virtual bool string( const String &value ) {
+        return scalar( 's', xml::escape_tag( value, format_ ) );
+    }
+    virtual bool number( Number value ) {
+        std::string text;
+        format_number( text, value );
+        return scalar( 'n', text );
+    }
+    virtual bool integer( Integer value ) {
+        std::string text;
+        format_integer( text, value );
+        return scalar( 'n', text );
+    }
+    virtual bool boolean( Boolean value ) {
+        return scalar( 'b', value ? "true" : "false" );
+    }
+    virtual bool null() {
+        const std::string name = take_key();
+        ok_ = ok_ && tabs()
+            && out_->write( xml::open_tag( format_, '0', name, " /" ) )
+            && out_->put('\n');
+        return ok_;
+    }
+};
 
-    std::string result = tag( format, 0, std::string(), v, attrib.empty() ? std::string(defrootattrib[format]) : attrib );
+}  // namespace
 
-    v.object_value_ = 0;
-    return ( header.empty() ? std::string(defheader[format]) : header ) + result;
+bool reformat( const char *begin, const char *end, Sink &out, bool pretty ) {
+    StreamJsonWriter writer( out, pretty );
+    if( !parse_events( begin, end, writer ) || !writer.ok_ )
+        return false;
+    // same root trailer the buffered serializer appends in pretty mode
+    if( pretty && !out.write( " \n", 2 ) )
+        return false;
+    return out.flush();
 }
 
-std::string Array::json() const {
-    using namespace json;
-
-    jsonxx::Value v;
-    v.array_value_ = const_cast<jsonxx::Array*>(this);
-    v.type_ = jsonxx::Value::ARRAY_;
-
-    std::string result = tag( jsonxx::JSON, 0, std::string(), v );
+bool reformat( const char *data, size_t size, Sink &out, bool pretty ) {
+    return reformat( data, data + size, out, pretty );
+}
 
-    v.array_value_ = 0;
-    return remove_last_comma( result );
+bool reformat( const std::string &input, Sink &out, bool pretty ) {
+    return reformat( input.data(), input.data() + input.size(), out, pretty );
 }
 
-std::string Array::xml( unsigned format, const std::string &header, const std::string &attrib ) const {
+bool xml( const char *begin, const char *end, Sink &out, unsigned format ) {
     using namespace xml;
     JSONXX_ASSERT( format == jsonxx::JSONx || format == jsonxx::JXML || format == jsonxx::JXMLex || format == jsonxx::TaggedXML );
-
-    jsonxx::Value v;
-    v.array_value_ = const_cast<jsonxx::Array*>(this);
-    v.type_ = jsonxx::Value::ARRAY_;
-
-    std::string result = tag( format, 0, std::string(), v, attrib.empty() ? std::string(defrootattrib[format]) : attrib );
-
-    v.array_value_ = 0;
-    return ( header.empty() ? std::string(defheader[format]) : header ) + result;
+    if( !out.write( std::string( defheader[format] ) ) )
+        return false;
+    StreamXmlWriter writer( out, format, defrootattrib[format] );
+    return parse_events( begin, end, writer ) && writer.ok_ && out.flush();
 }
 
-bool validate( std::istream &input ) {
-
-    // trim non-printable chars
-    for( char ch(0); !input.eof() && input.peek() <= 32; )
-        input.get(ch);
-
-    // validate json
-    if( input.peek() == '{' )
-    {
-        jsonxx::Object o;
-        if( parse_object( input, o ) )
-            return true;
-    }
-    else
-    if( input.peek() == '[' )
-    {
-        jsonxx::Array a;
-        if( parse_array( input, a ) )
-            return true;
-    }
-
-    // bad json input
-    return false;
+bool xml( const char *data, size_t size, Sink &out, unsigned format ) {
+    return jsonxx::xml( data, data + size, out, format );
 }
 
-bool validate( const std::string &input ) {
-    std::istringstream is( input );
-    return jsonxx::validate( is );
+bool xml( const std::string &input, Sink &out, unsigned format ) {
+    return jsonxx::xml( input.data(), input.data() + input.size(), out, format );
 }
 
 std::string reformat( std::istream &input ) {
@@ -925,26 +3037,117 @@ std::string xml( const std::string &input, unsigned format ) {
 }
 
 
-Object::Object(const Object &other) {
+// Iterative teardown, shared by the container reset()s below. Every
+// Value on the stack is heap-owned; a container hands its children to
+// the stack before its node dies, so each delete runs on an empty
+// payload and teardown never recurses deeper than one level -- trees as
+// deep as the iterative parser builds tear down flat, like the arena
+// path always did.
+void destroy_tree(std::vector<Value*> &stack) {
+  while (!stack.empty()) {
+    Value *v = stack.back();
+    stack.pop_back();
+    if (v->type_ == Value::OBJECT_ && !v->arena_) {
+      Object *o = v->object_value_;
+      Object::container::iterator i;
+      for (i = o->value_map_.begin(); i != o->value_map_.end(); ++i) {
+        if (!i->second->arena_) stack.push_back(i->second);
+      }
+      o->value_map_.clear();
+      o->order_.clear();
+    } else if (v->type_ == Value::ARRAY_ && !v->arena_) {
+      Array *a = v->array_value_;
+      Array::container::iterator i;
+      for (i = a->values_.begin(); i != a->values_.end(); ++i) {
+        if (!(*i)->arena_) stack.push_back(*i);
+      }
+      a->values_.clear();
+    }
+    delete v;
+  }
+}
+
+// One suspended source/destination pair of the iterative deep copy;
+// exactly one side of each is set. 'next' walks the source's children
+// in insertion order.
+struct CopyFrame {
+  const Object *src_object;
+  const Array *src_array;
+  Object *dst_object;
+  Array *dst_array;
+  size_t next;
+};
+
+// Iterative deep copy behind Object::import(const Object&) and
+// Array::import(const Array&), which between them close every copy
+// recursion (Value's copy constructor lands here for containers).
+// Scalars copy through Value::import; containers suspend the current
+// pair and descend through the frame stack instead of the C stack.
+void copy_tree(const Object *src_object, const Array *src_array, Object *dst_object, Array *dst_array) {
+  std::vector<CopyFrame> frames;
+  {
+    CopyFrame root = { src_object, src_array, dst_object, dst_array, 0 };
+    frames.push_back(root);
+  }
+  while (!frames.empty()) {
+    CopyFrame &f = frames.back();
+    const Value *src;
+    const std::string *key = 0;
+    if (f.src_object) {
+      if (f.next >= f.src_object->order_.size()) {
+        frames.pop_back();
+        continue;
+      }
+      key = &f.src_object->order_[f.next]->first;
+      src = f.src_object->order_[f.next]->second;
+    } else {
+      if (f.next >= f.src_array->values_.size()) {
+        frames.pop_back();
+        continue;
+      }
+      src = f.src_array->values_[f.next];
+    }
+    ++f.next;
+
+    Value *dst;
+    if (f.dst_object) {
+      Value *&slot = f.dst_object->assign(*key);
+      if (slot && !slot->arena_) delete slot;
+      slot = new Value();
+      dst = slot;
+    } else {
+      f.dst_array->values_.push_back(new Value());
+      dst = f.dst_array->values_.back();
+    }
+
+    if (src->type_ == Value::OBJECT_) {
+      dst->type_ = Value::OBJECT_;
+      dst->object_value_ = dst->make_object();
+      CopyFrame child = { src->object_value_, 0, dst->object_value_, 0, 0 };
+      frames.push_back(child);   // 'f' is dead past this point
+    } else if (src->type_ == Value::ARRAY_) {
+      dst->type_ = Value::ARRAY_;
+      dst->array_value_ = dst->make_array();
+      dst->array_value_->values_.reserve(src->array_value_->values_.size());
+      CopyFrame child = { 0, src->array_value_, 0, dst->array_value_, 0 };
+      frames.push_back(child);
+    } else {
+      dst->import(*src);   // scalars, raw slices, shared handles
+    }
+  }
+}
+
+Object::Object(const Object &other) : cache_(0) {
   import(other);
 }
-Object::Object(const std::string &key, const Value &value) {
+Object::Object(const std::string &key, const Value &value) : cache_(0) {
   import(key,value);
 }
 void Object::import( const Object &other ) {
   odd.clear();
   if (this != &other) {
     // default
-    container::const_iterator
-        it = other.value_map_.begin(),
-        end = other.value_map_.end();
-    for (/**/ ; it != end ; ++it) {
-      container::iterator found = value_map_.find(it->first);
-      if( found != value_map_.end() ) {
-        delete found->second;
-      }
-      value_map_[ it->first ] = new Value( *it->second );
-    }
+    copy_tree( &other, 0, this, 0 );
   } else {
     // recursion is supported here
     import( Object(*this) );
@@ -952,11 +3155,24 @@ void Object::import( const Object &other ) {
 }
 void Object::import( const std::string &key, const Value &value ) {
   odd.clear();
-  container::iterator found = value_map_.find(key);
-  if( found != value_map_.end() ) {
-    delete found->second;
+  Value *&slot = assign( key );
+  if( slot && !slot->arena_ ) delete slot;
+  slot = new Value( value );
+}
+Value &Object::set( const std::string &key ) {
+  odd.clear();
+  Value *&slot = assign( key );
+  if( slot ) {
+    // patch in place, keeping the node (and its arena). reset() only
+    // drops the payload, so mark the slot INVALID_ too: an unassigned
+    // slot then reads empty and serializes as null instead of posing as
+    // its old type with a dead pointer.
+    slot->reset();
+    slot->type_ = Value::INVALID_;
+  } else {
+    slot = new Value();
   }
-  value_map_[ key ] = new Value( value );
+  return *slot;
 }
 Object &Object::operator=(const Object &other) {
   odd.clear();
@@ -966,11 +3182,60 @@ Object &Object::operator=(const Object &other) {
   }
   return *this;
 }
+#if JSONXX_COMPILER_HAS_CXX11 > 0
+Object::Object(Object &&other) : value_map_(), cache_(0) {
+  value_map_.swap(other.value_map_);
+  order_.swap(other.order_);
+  other.touch();
+}
+Object &Object::operator=(Object &&other) {
+  odd.clear();
+  if (this != &other) {
+    reset();
+    value_map_.swap(other.value_map_);
+    order_.swap(other.order_);
+    other.touch();
+  }
+  return *this;
+}
+void Object::import( Object &&other ) {
+  odd.clear();
+  if (this != &other) {
+    ordering::const_iterator
+        it = other.order_.begin(),
+        end = other.order_.end();
+    for (/**/ ; it != end ; ++it) {
+      Value *&slot = assign( (*it)->first );
+      if( slot && !slot->arena_ ) delete slot;
+      slot = (*it)->second;
+    }
+    other.value_map_.clear();
+    other.order_.clear();
+    other.touch();
+  }
+}
+void Object::import( const std::string &key, Value &&value ) {
+  odd.clear();
+  Value *&slot = assign( key );
+  if( slot && !slot->arena_ ) delete slot;
+  slot = new Value( std::move(value) );
+}
+Object &Object::operator<<(Value &&value) {
+  if (odd.empty()) {
+    odd = value.get<String>();
+  } else {
+    import( std::string(odd), std::move(value) );
+    odd.clear();
+  }
+  return *this;
+}
+#endif
 Object &Object::operator<<(const Value &value) {
   if (odd.empty()) {
     odd = value.get<String>();
   } else {
-    import( Object(odd, value) );
+    // copy the key first: import() clears 'odd' before reading it
+    import( std::string(odd), value );
     odd.clear();
   }
   return *this;
@@ -986,49 +3251,289 @@ size_t Object::size() const {
 bool Object::empty() const {
   return value_map_.size() == 0;
 }
-const std::map<std::string, Value*> &Object::kv_map() const {
+const Object::container &Object::kv_map() const {
   return value_map_;
 }
+const Object::ordering &Object::kv_order() const {
+  return order_;
+}
+Value *Object::find(const std::string &key) {
+  touch();   // the caller may mutate through the pointer
+  container::iterator it = value_map_.find(key);
+  return it != value_map_.end() ? it->second : 0;
+}
+const Value *Object::find(const std::string &key) const {
+  container::const_iterator it = value_map_.find(key);
+  return it != value_map_.end() ? it->second : 0;
+}
+void Object::reserve(size_t n) {
+  order_.reserve(n);
+#if defined(JSONXX_UNORDERED_OBJECT) && JSONXX_COMPILER_HAS_CXX11 > 0
+  value_map_.reserve(n);
+#endif
+}
+Value *&Object::assign(const std::string &key) {
+  touch();
+  std::pair<container::iterator, bool> result =
+      value_map_.insert(container::value_type(key, (Value*)0));
+  if (result.second) order_.push_back(&*result.first);
+  return result.first->second;
+}
+Path::Path() : valid_(false) {}
+Path::Path(const char *path) : valid_(false) {
+  compile(path);
+}
+Path::Path(const std::string &path) : valid_(false) {
+  compile(path.c_str());
+}
+bool Path::valid() const {
+  return valid_;
+}
+size_t Path::size() const {
+  return tokens_.size();
+}
+bool Path::compile(const char *path) {
+  tokens_.clear();
+  valid_ = false;
+  if (!path || !*path) return false;
+  const char *cur = path;
+  if (*cur == '/') {
+    // JSON Pointer: '/'-separated tokens, ~1 unescapes to '/', ~0 to '~'
+    while (*cur == '/') {
+      ++cur;
+      Token token;
+      while (*cur && *cur != '/') {
+        if (*cur == '~') {
+          if (cur[1] == '0') token.key += '~';
+          else if (cur[1] == '1') token.key += '/';
+          else return false;
+          cur += 2;
+        } else {
+          token.key += *cur++;
+        }
+      }
+      token.is_index = !token.key.empty();
+      token.index = 0;
+      for (size_t i = 0; i < token.key.size(); ++i) {
+        if (!isdigit((unsigned char)token.key[i])) { token.is_index = false; break; }
+        token.index = token.index * 10 + (token.key[i] - '0');
+      }
+      tokens_.push_back(token);
+    }
+  } else {
+    // dotted syntax: keys separated by '.', array indices in brackets
+    for (;;) {
+      Token token;
+      if (*cur == '[') {
+        ++cur;
+        if (!isdigit((unsigned char)*cur)) return false;
+        token.is_index = true;
+        token.index = 0;
+        while (isdigit((unsigned char)*cur)) {
+          token.key += *cur;
+          token.index = token.index * 10 + (*cur - '0');
+          ++cur;
+        }
+        if (*cur != ']') return false;
+        ++cur;
+      } else {
+        while (*cur && *cur != '.' && *cur != '[') token.key += *cur++;
+        if (token.key.empty()) return false;
+        token.is_index = !token.key.empty();
+        token.index = 0;
+        for (size_t i = 0; i < token.key.size(); ++i) {
+          if (!isdigit((unsigned char)token.key[i])) { token.is_index = false; break; }
+          token.index = token.index * 10 + (token.key[i] - '0');
+        }
+      }
+      tokens_.push_back(token);
+      if (!*cur) break;
+      if (*cur == '.') {
+        ++cur;
+        if (!*cur) return false;
+      } else if (*cur != '[') {
+        return false;
+      }
+    }
+  }
+  valid_ = true;
+  return valid_;
+}
+Value *Object::query(const Path &path) {
+  if (!path.valid_ || path.tokens_.empty()) return 0;
+  const Object *obj = this;
+  const Array *arr = 0;
+  Value *cur = 0;
+  for (size_t i = 0, n = path.tokens_.size(); i < n; ++i) {
+    const Path::Token &token = path.tokens_[i];
+    if (obj) {
+      container::const_iterator it = obj->value_map_.find(token.key);
+      if (it == obj->value_map_.end()) return 0;
+      cur = it->second;
+    } else if (arr && token.is_index) {
+      if (token.index >= arr->size()) return 0;
+      cur = arr->values()[token.index];
+    } else {
+      return 0;
+    }
+    obj = 0;
+    arr = 0;
+    if (i + 1 < n) {
+      // is<>/get<> rather than type_ so lazy slices materialize in place
+      if (cur->is<Object>()) obj = &cur->get<Object>();
+      else if (cur->is<Array>()) arr = &cur->get<Array>();
+      else return 0;
+    }
+  }
+  return cur;
+}
+Value *Object::query(const char *path) {
+  return query(Path(path));
+}
+// Own traversal rather than a const_cast into the overload above: the
+// mutable walk detaches shared payloads (copy-on-write), which a const
+// read must never do.
+const Value *Object::query(const Path &path) const {
+  if (!path.valid_ || path.tokens_.empty()) return 0;
+  const Object *obj = this;
+  const Array *arr = 0;
+  const Value *cur = 0;
+  for (size_t i = 0, n = path.tokens_.size(); i < n; ++i) {
+    const Path::Token &token = path.tokens_[i];
+    if (obj) {
+      container::const_iterator it = obj->value_map_.find(token.key);
+      if (it == obj->value_map_.end()) return 0;
+      cur = it->second;
+    } else if (arr && token.is_index) {
+      if (token.index >= arr->size()) return 0;
+      cur = arr->values()[token.index];
+    } else {
+      return 0;
+    }
+    obj = 0;
+    arr = 0;
+    if (i + 1 < n) {
+      // const get<> still materializes lazy slices in place, but looks
+      // through a shared payload instead of detaching it
+      if (cur->is<Object>()) obj = &cur->get<Object>();
+      else if (cur->is<Array>()) arr = &cur->get<Array>();
+      else return 0;
+    }
+  }
+  return cur;
+}
+const Value *Object::query(const char *path) const {
+  return query(Path(path));
+}
 std::string Object::write( unsigned format ) const {
   return format == JSON ? json() : xml(format);
 }
+void Object::cache_json( bool enabled ) {
+  if( !enabled ) {
+    delete cache_;
+    cache_ = 0;
+    return;
+  }
+  if( !cache_ ) cache_ = new JsonCache();
+  cache_->valid = false;   // re-arm after any out-of-band mutation
+}
 void Object::reset() {
+  touch();
+  std::vector<Value*> stack;
   container::iterator i;
   for (i = value_map_.begin(); i != value_map_.end(); ++i) {
-    delete i->second;
+    if (!i->second->arena_) stack.push_back(i->second);
   }
   value_map_.clear();
+  order_.clear();
+  destroy_tree(stack);
 }
 bool Object::parse(std::istream &input) {
   return parse(input,*this);
 }
 bool Object::parse(const std::string &input) {
-  std::istringstream is( input );
-  return parse(is,*this);
+  return parse(input.data(), input.data() + input.size());
+}
+bool Object::parse(const char *begin, const char *end) {
+  const char *cur = begin;
+  return parse(cur,end,*this);
+}
+bool Object::parse(const char *data, size_t size) {
+  return parse(data, data + size);
+}
+bool Object::parse(const std::string &input, Arena &arena) {
+  return parse(input.data(), input.data() + input.size(), arena);
+}
+bool Object::parse(const char *begin, const char *end, Arena &arena) {
+  const char *cur = begin;
+  return parse(cur,end,*this,&arena);
+}
+bool Object::parse(const char *data, size_t size, Arena &arena) {
+  return parse(data, data + size, arena);
+}
+bool Object::parse_lazy(const std::string &input) {
+  return parse_lazy(input.data(), input.data() + input.size());
+}
+bool Object::parse_lazy(const char *begin, const char *end) {
+  const char *cur = begin;
+  return parse(cur,end,*this,0,true);
+}
+bool Object::parse_lazy(const char *data, size_t size) {
+  return parse_lazy(data, data + size);
+}
+bool Object::parse_lazy(const std::string &input, Arena &arena) {
+  return parse_lazy(input.data(), input.data() + input.size(), arena);
+}
+bool Object::parse_lazy(const char *begin, const char *end, Arena &arena) {
+  const char *cur = begin;
+  return parse(cur,end,*this,&arena,true);
+}
+bool Object::parse_lazy(const char *data, size_t size, Arena &arena) {
+  return parse_lazy(data, data + size, arena);
+}
+bool Object::parse(const std::string &input, const ParseOptions &options) {
+  return parse(input.data(), input.data() + input.size(), options);
+}
+bool Object::parse(const char *begin, const char *end, const ParseOptions &options) {
+  if (options.max_bytes && size_t(end - begin) > options.max_bytes) {
+    return false;
+  }
+  ParseState state(options);
+  const char *cur = begin;
+  return parse(cur,end,*this,0,false,&state) && !state.exceeded;
+}
+bool Object::parse(const char *data, size_t size, const ParseOptions &options) {
+  return parse(data, data + size, options);
 }
 
 
-Array::Array(const Array &other) {
+Array::Array(const Array &other) : cache_(0) {
   import(other);
 }
-Array::Array(const Value &value) {
+Array::Array(const Value &value) : cache_(0) {
   import(value);
 }
+void Array::reserve(size_t n) {
+  values_.reserve(n);
+}
+Value &Array::emplace_back() {
+  touch();
+  values_.push_back( new Value() );
+  return *values_.back();
+}
 void Array::import(const Array &other) {
+  touch();
   if (this != &other) {
     // default
-    container::const_iterator
-        it = other.values_.begin(),
-        end = other.values_.end();
-    for (/**/ ; it != end; ++it) {
-      values_.push_back( new Value(**it) );
-    }
+    values_.reserve(values_.size() + other.values_.size());
+    copy_tree( 0, &other, 0, this );
   } else {
     // recursion is supported here
     import( Array(*this) );
   }
 }
 void Array::import(const Value &value) {
+  touch();
   values_.push_back( new Value(value) );
 }
 size_t Array::size() const {
@@ -1037,18 +3542,60 @@ size_t Array::size() const {
 bool Array::empty() const {
   return values_.size() == 0;
 }
+void Array::cache_json( bool enabled ) {
+  if( !enabled ) {
+    delete cache_;
+    cache_ = 0;
+    return;
+  }
+  if( !cache_ ) cache_ = new JsonCache();
+  cache_->valid = false;   // re-arm after any out-of-band mutation
+}
 void Array::reset() {
+  touch();
+  std::vector<Value*> stack;
   for (container::iterator i = values_.begin(); i != values_.end(); ++i) {
-    delete *i;
+    if (!(*i)->arena_) stack.push_back(*i);
   }
   values_.clear();
+  destroy_tree(stack);
 }
 bool Array::parse(std::istream &input) {
   return parse(input,*this);
 }
 bool Array::parse(const std::string &input) {
-  std::istringstream is(input);
-  return parse(is,*this);
+  return parse(input.data(), input.data() + input.size());
+}
+bool Array::parse(const char *begin, const char *end) {
+  const char *cur = begin;
+  return parse(cur,end,*this);
+}
+bool Array::parse(const char *data, size_t size) {
+  return parse(data, data + size);
+}
+bool Array::parse(const std::string &input, Arena &arena) {
+  return parse(input.data(), input.data() + input.size(), arena);
+}
+bool Array::parse(const char *begin, const char *end, Arena &arena) {
+  const char *cur = begin;
+  return parse(cur,end,*this,&arena);
+}
+bool Array::parse(const char *data, size_t size, Arena &arena) {
+  return parse(data, data + size, arena);
+}
+bool Array::parse(const std::string &input, const ParseOptions &options) {
+  return parse(input.data(), input.data() + input.size(), options);
+}
+bool Array::parse(const char *begin, const char *end, const ParseOptions &options) {
+  if (options.max_bytes && size_t(end - begin) > options.max_bytes) {
+    return false;
+  }
+  ParseState state(options);
+  const char *cur = begin;
+  return parse(cur,end,*this,0,false,&state) && !state.exceeded;
+}
+bool Array::parse(const char *data, size_t size, const ParseOptions &options) {
+  return parse(data, data + size, options);
 }
 Array &Array::operator<<(const Array &other) {
   import(other);
@@ -1070,10 +3617,86 @@ Array &Array::operator=(const Value &value) {
   import(value);
   return *this;
 }
+#if JSONXX_COMPILER_HAS_CXX11 > 0
+Array::Array(Array &&other) : values_(), cache_(0) {
+  values_.swap(other.values_);
+  other.touch();
+}
+Array &Array::operator=(Array &&other) {
+  if( this != &other ) {
+    reset();
+    values_.swap(other.values_);
+    other.touch();
+  }
+  return *this;
+}
+void Array::import(Array &&other) {
+  touch();
+  if (this != &other) {
+    values_.insert( values_.end(), other.values_.begin(), other.values_.end() );
+    other.values_.clear();
+    other.touch();
+  }
+}
+void Array::import(Value &&value) {
+  touch();
+  values_.push_back( new Value( std::move(value) ) );
+}
+Array &Array::operator<<(Value &&value) {
+  import( std::move(value) );
+  return *this;
+}
+#endif
 
-Value::Value(const Value &other) : type_(INVALID_) {
+Value::Value(const Value &other) : type_(INVALID_), arena_(0) {
   import( other );
 }
+#if JSONXX_COMPILER_HAS_CXX11 > 0
+void Value::import( Value &&other ) {
+  if (this == &other) {
+    return;
+  }
+  if (arena_ || other.arena_) {
+    // arena-owned payloads cannot change owner; fall back to a deep copy
+    import( static_cast<const Value &>(other) );
+    return;
+  }
+  reset();
+  switch (other.type_) {
+    case NUMBER_:
+      number_value_ = other.number_value_;
+      break;
+    case INT_:
+      int_value_ = other.int_value_;
+      break;
+    case BOOL_:
+      bool_value_ = other.bool_value_;
+      break;
+    case STRING_:
+      string_value_ = other.string_value_;
+      break;
+    case SSTRING_:
+      std::memcpy( sstring_value_, other.sstring_value_, sizeof(sstring_value_) );
+      break;
+    case RAW_:
+      raw_value_ = other.raw_value_;
+      break;
+    case SHARED_:
+      shared_value_ = other.shared_value_;   // the refcount moves over
+      break;
+    case ARRAY_:
+      array_value_ = other.array_value_;
+      break;
+    case OBJECT_:
+      object_value_ = other.object_value_;
+      break;
+    default:
+      break;
+  }
+  type_ = other.type_;
+  other.type_ = INVALID_;
+}
+#endif
 bool Value::empty() const {
   if( type_ == INVALID_ ) return true;
   if( type_ == STRING_ && string_value_ == 0 ) return true;
@@ -1085,8 +3708,287 @@ bool Value::parse(std::istream &input) {
   return parse(input,*this);
 }
 bool Value::parse(const std::string &input) {
-  std::istringstream is( input );
-  return parse(is,*this);
+  return parse(input.data(), input.data() + input.size());
+}
+bool Value::parse(const char *begin, const char *end) {
+  reset();
+  arena_ = 0;
+  const char *cur = begin;
+  return parse(cur,end,*this);
+}
+bool Value::parse(const char *data, size_t size) {
+  return parse(data, data + size);
+}
+bool Value::parse(const std::string &input, Arena &arena) {
+  return parse(input.data(), input.data() + input.size(), arena);
+}
+bool Value::parse(const char *begin, const char *end, Arena &arena) {
+  reset();
+  arena_ = &arena;
+  const char *cur = begin;
+  return parse(cur,end,*this);
+}
+bool Value::parse(const char *data, size_t size, Arena &arena) {
+  return parse(data, data + size, arena);
+}
+bool Value::parse_lazy(const std::string &input) {
+  return parse_lazy(input.data(), input.data() + input.size());
+}
+bool Value::parse_lazy(const char *begin, const char *end) {
+  reset();
+  arena_ = 0;
+  const char *cur = begin;
+  return parse(cur,end,*this,true);
+}
+bool Value::parse_lazy(const char *data, size_t size) {
+  return parse_lazy(data, data + size);
+}
+bool Value::parse_lazy(const std::string &input, Arena &arena) {
+  return parse_lazy(input.data(), input.data() + input.size(), arena);
+}
+bool Value::parse_lazy(const char *begin, const char *end, Arena &arena) {
+  reset();
+  arena_ = &arena;
+  const char *cur = begin;
+  return parse(cur,end,*this,true);
+}
+bool Value::parse_lazy(const char *data, size_t size, Arena &arena) {
+  return parse_lazy(data, data + size, arena);
+}
+bool Value::parse(const std::string &input, const ParseOptions &options) {
+  return parse(input.data(), input.data() + input.size(), options);
+}
+bool Value::parse(const char *begin, const char *end, const ParseOptions &options) {
+  if (options.max_bytes && size_t(end - begin) > options.max_bytes) {
+    return false;
+  }
+  reset();
+  arena_ = 0;
+  ParseState state(options);
+  const char *cur = begin;
+  return parse(cur,end,*this,false,&state) && !state.exceeded;
+}
+bool Value::parse(const char *data, size_t size, const ParseOptions &options) {
+  return parse(data, data + size, options);
+}
+
+namespace {
+
+// Snapshot header: format tag plus payload widths, so a snapshot taken
+// on a different architecture is rejected up front instead of decoding
+// garbage.
+const char binary_magic[4] = { 'j', 'x', 'b', '1' };
+
+bool write_raw(std::ostream &out, const void *data, size_t size) {
+  return !!out.write(static_cast<const char*>(data), size);
+}
+bool read_raw(std::istream &in, void *data, size_t size) {
+  return !!in.read(static_cast<char*>(data), size);
+}
+bool write_size(std::ostream &out, size_t size) {
+  unsigned n = (unsigned)size;
+  return size <= 0xffffffffu && write_raw(out, &n, sizeof(n));
+}
+bool read_size(std::istream &in, unsigned &n) {
+  return read_raw(in, &n, sizeof(n));
+}
+bool write_binary_string(std::ostream &out, const char *data, size_t size) {
+  return write_size(out, size) && (size == 0 || write_raw(out, data, size));
+}
+bool read_binary_string(std::istream &in, std::string &s) {
+  unsigned n = 0;
+  if (!read_size(in, n)) return false;
+  s.resize(n);
+  return n == 0 || read_raw(in, &s[0], n);
+}
+bool write_binary_header(std::ostream &out) {
+  unsigned char widths[2] = { (unsigned char)sizeof(Number), (unsigned char)sizeof(long long) };
+  return write_raw(out, binary_magic, sizeof(binary_magic))
+      && write_raw(out, widths, sizeof(widths));
+}
+bool read_binary_header(std::istream &in) {
+  char magic[4];
+  unsigned char widths[2];
+  return read_raw(in, magic, sizeof(magic))
+      && read_raw(in, widths, sizeof(widths))
+      && memcmp(magic, binary_magic, sizeof(binary_magic)) == 0
+      && widths[0] == sizeof(Number)
+      && widths[1] == sizeof(long long);
+}
+
+}  // namespace
+
+bool Value::write_binary(std::ostream &out, const Value &value) {
+  // lazy slices parse in place first, like the text serializers
+  if (value.type_ == RAW_)
+    const_cast<Value &>(value).materialize();
+  // a shared payload flattens: each reference writes the full subtree
+  if (value.type_ == SHARED_)
+    return write_binary(out, value.deref());
+  char type = 0;
+  switch (value.type_) {
+    case NUMBER_:
+      type = 'n';
+      return write_raw(out, &type, 1)
+          && write_raw(out, &value.number_value_, sizeof(value.number_value_));
+    case INT_:
+      type = 'i';
+      return write_raw(out, &type, 1)
+          && write_raw(out, &value.int_value_, sizeof(value.int_value_));
+    case STRING_:
+      type = 's';
+      return write_raw(out, &type, 1)
+          && write_binary_string(out, value.string_value_->data(), value.string_value_->size());
+    case SSTRING_:
+      type = 's';
+      return write_raw(out, &type, 1)
+          && write_binary_string(out, value.sstring_data(), value.sstring_size());
+    case BOOL_:
+      type = value.bool_value_ ? 't' : 'f';
+      return write_raw(out, &type, 1);
+    case NULL_:
+      type = 'z';
+      return write_raw(out, &type, 1);
+    case ARRAY_:
+      type = 'a';
+      return write_raw(out, &type, 1) && Array::write_binary(out, *value.array_value_);
+    case OBJECT_:
+      type = 'o';
+      return write_raw(out, &type, 1) && Object::write_binary(out, *value.object_value_);
+    default:
+      return false;
+  }
+}
+bool Value::read_binary(std::istream &in, Value &value) {
+  value.reset();
+  value.type_ = INVALID_;
+  char type = 0;
+  if (!read_raw(in, &type, 1)) return false;
+  switch (type) {
+    case 'n':
+      if (!read_raw(in, &value.number_value_, sizeof(value.number_value_))) return false;
+      value.type_ = NUMBER_;
+      return true;
+    case 'i':
+      if (!read_raw(in, &value.int_value_, sizeof(value.int_value_))) return false;
+      value.type_ = INT_;
+      return true;
+    case 's': {
+      std::string s;
+      if (!read_binary_string(in, s)) return false;
+      if (s.size() <= (size_t)SSTRING_CAPACITY) {
+        value.set_sstring(s.data(), s.size());
+        value.type_ = SSTRING_;
+      } else {
+        value.string_value_ = value.make_string();
+        value.string_value_->swap(s);
+        value.type_ = STRING_;
+      }
+      return true;
+    }
+    case 't':
+      value.bool_value_ = true;
+      value.type_ = BOOL_;
+      return true;
+    case 'f':
+      value.bool_value_ = false;
+      value.type_ = BOOL_;
+      return true;
+    case 'z':
+      value.type_ = NULL_;
+      return true;
+    case 'a':
+      value.array_value_ = value.make_array();
+      if (!Array::read_binary(in, *value.array_value_)) {
+        if (!value.arena_) delete value.array_value_;
+        return false;
+      }
+      value.type_ = ARRAY_;
+      return true;
+    case 'o':
+      value.object_value_ = value.make_object();
+      if (!Object::read_binary(in, *value.object_value_)) {
+        if (!value.arena_) delete value.object_value_;
+        return false;
+      }
+      value.type_ = OBJECT_;
+      return true;
+    default:
+      return false;
+  }
+}
+bool Value::save_binary(std::ostream &out) const {
+  return write_binary_header(out) && write_binary(out, *this);
+}
+bool Value::load_binary(std::istream &in) {
+  return read_binary_header(in) && read_binary(in, *this);
+}
+
+bool Object::write_binary(std::ostream &out, const Object &object) {
+  if (!write_size(out, object.order_.size())) return false;
+  ordering::const_iterator
+      it = object.order_.begin(),
+      end = object.order_.end();
+  for (/**/ ; it != end; ++it) {
+    if (!write_binary_string(out, (*it)->first.data(), (*it)->first.size())) return false;
+    if (!Value::write_binary(out, *(*it)->second)) return false;
+  }
+  return true;
+}
+bool Object::read_binary(std::istream &in, Object &object) {
+  object.reset();
+  unsigned count = 0;
+  if (!read_size(in, count)) return false;
+  for (unsigned i = 0; i < count; ++i) {
+    std::string key;
+    if (!read_binary_string(in, key)) return false;
+    Value *v = new Value();
+    if (!Value::read_binary(in, *v)) {
+      delete v;
+      return false;
+    }
+    Value *&slot = object.assign(key);
+    if (slot && !slot->arena_) delete slot;
+    slot = v;
+  }
+  return true;
+}
+bool Object::save_binary(std::ostream &out) const {
+  return write_binary_header(out) && write_binary(out, *this);
+}
+bool Object::load_binary(std::istream &in) {
+  return read_binary_header(in) && read_binary(in, *this);
+}
+
+bool Array::write_binary(std::ostream &out, const Array &array) {
+  if (!write_size(out, array.values_.size())) return false;
+  container::const_iterator
+      it = array.values_.begin(),
+      end = array.values_.end();
+  for (/**/ ; it != end; ++it) {
+    if (!Value::write_binary(out, **it)) return false;
+  }
+  return true;
+}
+bool Array::read_binary(std::istream &in, Array &array) {
+  array.reset();
+  unsigned count = 0;
+  if (!read_size(in, count)) return false;
+  for (unsigned i = 0; i < count; ++i) {
+    Value *v = new Value();
+    if (!Value::read_binary(in, *v)) {
+      delete v;
+      return false;
+    }
+    array.values_.push_back(v);
+  }
+  return true;
+}
+bool Array::save_binary(std::ostream &out) const {
+  return write_binary_header(out) && write_binary(out, *this);
+}
+bool Array::load_binary(std::istream &in) {
+  return read_binary_header(in) && read_binary(in, *this);
 }
 
 }  // namespace jsonxx
@@ -8,8 +8,15 @@
 #pragma once
 
 #include <cassert>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
+#include <iterator>
 #include <map>
+#include <new>
+#include <utility>
 #include <vector>
 #include <string>
 #include <sstream>
@@ -32,6 +39,18 @@
 #define JSONXX_COMPILER_HAS_CXX11 0
 #endif
 
+// Define JSONXX_UNORDERED_OBJECT to back Object with std::unordered_map
+// instead of std::map: O(1) key lookup/insertion at the cost of sorted
+// iteration order. Requires C++11. Pick one flavor for the whole program.
+#if defined(JSONXX_UNORDERED_OBJECT) && JSONXX_COMPILER_HAS_CXX11 > 0
+#include <unordered_map>
+#endif
+
+#if JSONXX_COMPILER_HAS_CXX11 > 0
+#include <atomic>        // lock-free refcounts for Shared snapshots
+#include <type_traits>   // the JSONXX_BIND() schema binding layer
+#endif
+
 #define JSONXX_ASSERT(...) do { if( jsonxx::Assertions ) \
   jsonxx::assertion(__FILE__,__LINE__,#__VA_ARGS__,bool(__VA_ARGS__)); } while(0)
 
@@ -60,12 +79,14 @@ enum Format {
 
 // Types
 typedef long double Number;
+typedef long long Integer;
 typedef bool Boolean;
 typedef std::string String;
 struct Null {};
 class Value;
 class Object;
 class Array;
+class Sink;
 
 // Identity meta-function
 template <typename T>
@@ -74,16 +95,534 @@ struct identity {
 };
 
 // Tools
+// validate() checks well-formedness with a tokenizing walk of the input;
+// no document is built, and the only allocation is a byte of nesting
+// state per open container, so any document the parser can swallow
+// validates too.
+bool validate( const char *begin, const char *end );
+bool validate( const char *data, size_t size );
 bool validate( const std::string &input );
 bool validate( std::istream &input );
+// Parse newline-delimited JSON (one document per line, blank lines are
+// skipped) into 'out', preserving input order. Lines are distributed over
+// 'threads' workers; 0 means hardware concurrency. Without C++11 the
+// batch is parsed on the calling thread. Returns true if every document
+// parsed successfully.
+bool parse_many( const char *data, size_t size, std::vector<Object> &out, unsigned threads = 0 );
+bool parse_many( const std::string &input, std::vector<Object> &out, unsigned threads = 0 );
 std::string reformat( const std::string &input );
 std::string reformat( std::istream &input );
 std::string xml( const std::string &input, unsigned format = JSONx );
 std::string xml( std::istream &input, unsigned format = JSONx );
+// Streaming flavor of the two above: the event tokenizer pipes straight
+// into 'out', so a transcode touches the input bytes plus O(depth)
+// writer state -- no DOM, no output text buffer. reformat() emits the
+// bytes json() produces (compact with pretty=false); xml() matches
+// Object::xml with the default header and root attributes. False means
+// malformed JSON or a failed write; bytes already streamed stay written.
+bool reformat( const char *begin, const char *end, Sink &out, bool pretty = true );
+bool reformat( const char *data, size_t size, Sink &out, bool pretty = true );
+bool reformat( const std::string &input, Sink &out, bool pretty = true );
+bool xml( const char *begin, const char *end, Sink &out, unsigned format = JSONx );
+bool xml( const char *data, size_t size, Sink &out, unsigned format = JSONx );
+bool xml( const std::string &input, Sink &out, unsigned format = JSONx );
+
+// Budgets for parsing untrusted input; 0 means unlimited. Passed to the
+// parse() overloads below, checked in the parser hot loops, and any
+// exceeded budget fails the parse immediately — a nesting bomb is
+// rejected after max_depth bytes instead of after seconds of CPU.
+struct ParseOptions {
+  ParseOptions()
+      : max_depth(0), max_nodes(0), max_string(0), max_bytes(0) {}
+  size_t max_depth;    // open containers at any point
+  size_t max_nodes;    // values allocated over the whole document
+  size_t max_string;   // bytes in any single string or key
+  size_t max_bytes;    // total document size, checked before scanning
+};
+
+// Shared immutable strings: equal inputs resolve to one pooled copy whose
+// address is stable for the life of the program. Thread-safe under C++11
+// (a mutex guards the table); earlier dialects must synchronize callers
+// externally. The pool lives for the whole process and is never pruned,
+// so only feed it keys the program already treats as a fixed vocabulary
+// -- never attacker-controlled input. Note the bound: Object's map is
+// keyed by std::string, so a map entry is still its own copy --
+// interning deduplicates the strings callers keep around, not the
+// container keys.
+const String &intern( const String &key );
+
+// Opt-in performance counters. Define JSONXX_ENABLE_STATS when building
+// jsonxx.cc (and anything that reads them) to compile the hooks in; by
+// default they cost nothing and stats() returns all zeros. Counters
+// cover the char-range fast path -- the istream engines are the legacy
+// slow path and stay unhooked. With C++11 every thread gets its own set,
+// so a snapshot needs no locks; pre-C++11 one set is shared and callers
+// synchronize externally, same as intern(). Timers count wall time on
+// the POSIX monotonic clock at the parse/serialize entry points only --
+// per-token timers would cost more than they measure; the token counts
+// carry that signal instead.
+struct Stats {
+  Stats()
+      : parses(0), bytes_parsed(0), nodes_created(0), strings_parsed(0),
+        numbers_parsed(0), escaped_bytes(0), peak_depth(0), parse_ns(0),
+        json_ns(0) {}
+  unsigned long long parses;          // top-level text parses
+  unsigned long long bytes_parsed;    // input bytes those parses consumed
+  unsigned long long nodes_created;   // heap/arena nodes built by the parsers
+  unsigned long long strings_parsed;  // string tokens, object keys included
+  unsigned long long numbers_parsed;  // number and integer tokens
+  unsigned long long escaped_bytes;   // bytes run through the output escaper
+  unsigned long long peak_depth;      // deepest container nesting parsed
+  unsigned long long parse_ns;        // wall time inside the text parsers
+  unsigned long long json_ns;         // wall time inside the serializers
+};
+// Snapshot / zero the calling thread's counters.
+Stats stats();
+void reset_stats();
+
+// Per-parse counters enforcing ParseOptions; internal to the engine.
+struct ParseState;
 
 // Detail
 void assertion( const char *file, int line, const char *expression, bool result );
 
+// A bump allocator a document can be parsed into. Nodes are carved out of
+// large blocks instead of one new/delete round trip each, and the whole
+// tree is released at once when the arena is destroyed (or cleared).
+// The arena must outlive every document parsed into it.
+class Arena {
+ public:
+  Arena();
+  ~Arena();
+
+  void *allocate(size_t size);
+  void clear();
+
+  template<typename T>
+  T *create() {
+    T *t = new( allocate(sizeof(T)) ) T();
+    finalize( &destroy<T>, t );
+    return t;
+  }
+
+ private:
+  template<typename T>
+  static void destroy(void *object) {
+    static_cast<T*>(object)->~T();
+  }
+  void finalize( void (*destructor)(void *), void *object );
+  struct Block;
+  struct Finalizer;
+  Block *blocks_;
+  Finalizer *finalizers_;
+  char *cursor_;
+  size_t remaining_;
+  Arena(const Arena&);
+  Arena &operator=(const Arena&);
+};
+
+// Reusable parsing context for long-running workers: owns the options,
+// the arena and the per-parse scratch, so setup is paid once and many
+// inputs are fed through the same object. Documents parsed through a
+// Reader borrow its arena -- they are batch-freed by clear() (or the
+// Reader's destruction) and must not outlive it. Not thread-safe; make
+// one per thread. ("Reader" because the Settings enum already claims
+// the name Parser.)
+class Reader {
+ public:
+  explicit Reader( const ParseOptions &options = ParseOptions() );
+  ~Reader();
+
+  ParseOptions &options() { return options_; }
+  Arena &arena() { return arena_; }
+
+  bool parse( const std::string &input, Object &out );
+  bool parse( const char *begin, const char *end, Object &out );
+  bool parse( const std::string &input, Array &out );
+  bool parse( const char *begin, const char *end, Array &out );
+  bool parse( const std::string &input, Value &out );
+  bool parse( const char *begin, const char *end, Value &out );
+
+  // Release every node parsed so far in one sweep.
+  void clear();
+
+ private:
+  ParseOptions options_;
+  Arena arena_;
+  // Reusable frame stack for the iterative parse engine, so steady-state
+  // parses keep its capacity instead of growing a fresh one every call.
+  struct Scratch;
+  Scratch *scratch_;
+  Reader(const Reader&);
+  Reader &operator=(const Reader&);
+};
+
+// Serialization counterpart: the output buffer persists across calls, so
+// steady-state writes reuse its capacity instead of growing a fresh
+// string every time. The returned reference is valid until the next call.
+class Writer {
+ public:
+  const std::string &json( const Object &object );
+  const std::string &json( const Array &array );
+
+ private:
+  std::string buffer_;
+};
+
+// Event-driven parsing: the tokenizer reports document structure to a
+// handler instead of materializing a tree, so a few fields can be pulled
+// out of a large document without allocating any nodes. Return false
+// from any callback to abort the parse.
+class ParseHandler {
+ public:
+  virtual ~ParseHandler() {}
+  virtual bool begin_object() { return true; }
+  virtual bool end_object() { return true; }
+  virtual bool begin_array() { return true; }
+  virtual bool end_array() { return true; }
+  virtual bool key(const String &/*name*/) { return true; }
+  virtual bool string(const String &/*value*/) { return true; }
+  virtual bool number(Number /*value*/) { return true; }
+  // Integer tokens that fit 64 bits exactly, mirroring the DOM's INT_
+  // fast path. Forwards to number() so handlers that don't care about
+  // the distinction keep seeing one numeric event.
+  virtual bool integer(Integer value) { return number((Number)value); }
+  virtual bool boolean(Boolean /*value*/) { return true; }
+  virtual bool null() { return true; }
+};
+
+bool parse_events(const char *begin, const char *end, ParseHandler &handler);
+bool parse_events(const char *data, size_t size, ParseHandler &handler);
+bool parse_events(const std::string &input, ParseHandler &handler);
+bool parse_events(std::istream &input, ParseHandler &handler);
+
+#if JSONXX_COMPILER_HAS_CXX11 > 0
+
+// Compile-time schema binding. Declare the mapping once, at global scope:
+//
+//   struct Sample { long long id; double load; std::string host; bool ok; };
+//   JSONXX_BIND(Sample, id, load, host, ok)
+//
+// and parse_into() drives the SAX tokenizer straight into the struct --
+// no Value nodes, no map, no post-copy. Bound members must be arithmetic,
+// bool or std::string; unknown document keys (nested containers included)
+// are skipped, an absent or null key leaves the member untouched, and a
+// bound key holding the wrong type fails the parse. The document root
+// must be an object. C++11 only; up to 16 members per struct.
+
+// Conversions the binder accepts; any other event/member pairing is a
+// schema mismatch and aborts the parse through the generic overload.
+inline bool bind_assign(String &dst, const String &v) { dst = v; return true; }
+inline bool bind_assign(Boolean &dst, Boolean v) { dst = v; return true; }
+template <typename T>
+typename std::enable_if<std::is_arithmetic<T>::value && !std::is_same<T, bool>::value, bool>::type
+bind_assign(T &dst, Number v) { dst = static_cast<T>(v); return true; }
+template <typename T, typename V>
+bool bind_assign(T &, const V &) { return false; }
+
+// One bound member of a reflected struct: the JSON key plus type-erased
+// setters for each scalar event the SAX engine can report.
+template <typename Struct>
+struct bound_field {
+  const char *name;
+  bool (*from_string)(Struct &, const String &);
+  bool (*from_number)(Struct &, Number);
+  bool (*from_boolean)(Struct &, Boolean);
+};
+
+template <typename Struct, typename Member, Member Struct::*field>
+struct field_setter {
+  static bool from_string(Struct &s, const String &v) { return bind_assign(s.*field, v); }
+  static bool from_number(Struct &s, Number v) { return bind_assign(s.*field, v); }
+  static bool from_boolean(Struct &s, Boolean v) { return bind_assign(s.*field, v); }
+};
+
+// Specialized by JSONXX_BIND(); left undefined so parse_into() on an
+// unbound type fails to compile instead of silently parsing nothing.
+template <typename Struct>
+struct binding;
+
+// SAX handler routing root-level keys straight into struct members.
+template <typename Struct>
+class BindHandler : public ParseHandler {
+ public:
+  explicit BindHandler(Struct &out)
+      : out_(out), count_(0), fields_(binding<Struct>::fields(count_)),
+        current_(0), in_root_(false), skip_(0) {}
+
+  bool begin_object() {
+    if (skip_) { ++skip_; return true; }
+    if (!in_root_) { in_root_ = true; return true; }
+    if (current_) return false;       // bound members are scalars
+    ++skip_;                          // unknown key's subtree
+    return true;
+  }
+  bool end_object() {
+    if (skip_) { --skip_; return true; }
+    in_root_ = false;
+    return true;
+  }
+  bool begin_array() {
+    if (skip_) { ++skip_; return true; }
+    if (!in_root_ || current_) return false;
+    ++skip_;
+    return true;
+  }
+  bool end_array() {
+    if (skip_) --skip_;
+    return true;
+  }
+  bool key(const String &name) {
+    if (skip_) return true;
+    current_ = 0;                     // unknown keys fall through untouched
+    for (size_t i = 0; i < count_; ++i) {
+      if (name == fields_[i].name) { current_ = &fields_[i]; break; }
+    }
+    return true;
+  }
+  bool string(const String &v) {
+    if (skip_) return true;
+    if (!in_root_) return false;      // root must be an object
+    if (!current_) return true;
+    const bound_field<Struct> *f = current_; current_ = 0;
+    return f->from_string(out_, v);
+  }
+  bool number(Number v) {
+    if (skip_) return true;
+    if (!in_root_) return false;
+    if (!current_) return true;
+    const bound_field<Struct> *f = current_; current_ = 0;
+    return f->from_number(out_, v);
+  }
+  bool boolean(Boolean v) {
+    if (skip_) return true;
+    if (!in_root_) return false;
+    if (!current_) return true;
+    const bound_field<Struct> *f = current_; current_ = 0;
+    return f->from_boolean(out_, v);
+  }
+  bool null() {
+    if (skip_) return true;
+    if (!in_root_) return false;
+    current_ = 0;                     // explicit null keeps the default
+    return true;
+  }
+
+ private:
+  Struct &out_;
+  size_t count_;
+  const bound_field<Struct> *fields_;
+  const bound_field<Struct> *current_;
+  bool in_root_;
+  size_t skip_;                       // depth inside a skipped subtree
+};
+
+template <typename Struct>
+bool parse_into(const char *begin, const char *end, Struct &out) {
+  BindHandler<Struct> handler(out);
+  return parse_events(begin, end, handler);
+}
+template <typename Struct>
+bool parse_into(const char *data, size_t size, Struct &out) {
+  return parse_into(data, data + size, out);
+}
+template <typename Struct>
+bool parse_into(const std::string &input, Struct &out) {
+  return parse_into(input.data(), input.data() + input.size(), out);
+}
+template <typename Struct>
+bool parse_into(std::istream &input, Struct &out) {
+  BindHandler<Struct> handler(out);
+  return parse_events(input, handler);
+}
+
+#define JSONXX_BIND_FIELD(Type, member) \
+  { #member, \
+    &jsonxx::field_setter<Type, decltype(Type::member), &Type::member>::from_string, \
+    &jsonxx::field_setter<Type, decltype(Type::member), &Type::member>::from_number, \
+    &jsonxx::field_setter<Type, decltype(Type::member), &Type::member>::from_boolean }
+
+#define JSONXX_BIND_1(T, a) JSONXX_BIND_FIELD(T, a)
+#define JSONXX_BIND_2(T, a, ...) JSONXX_BIND_FIELD(T, a), JSONXX_BIND_1(T, __VA_ARGS__)
+#define JSONXX_BIND_3(T, a, ...) JSONXX_BIND_FIELD(T, a), JSONXX_BIND_2(T, __VA_ARGS__)
+#define JSONXX_BIND_4(T, a, ...) JSONXX_BIND_FIELD(T, a), JSONXX_BIND_3(T, __VA_ARGS__)
+#define JSONXX_BIND_5(T, a, ...) JSONXX_BIND_FIELD(T, a), JSONXX_BIND_4(T, __VA_ARGS__)
+#define JSONXX_BIND_6(T, a, ...) JSONXX_BIND_FIELD(T, a), JSONXX_BIND_5(T, __VA_ARGS__)
+#define JSONXX_BIND_7(T, a, ...) JSONXX_BIND_FIELD(T, a), JSONXX_BIND_6(T, __VA_ARGS__)
+#define JSONXX_BIND_8(T, a, ...) JSONXX_BIND_FIELD(T, a), JSONXX_BIND_7(T, __VA_ARGS__)
+#define JSONXX_BIND_9(T, a, ...) JSONXX_BIND_FIELD(T, a), JSONXX_BIND_8(T, __VA_ARGS__)
+#define JSONXX_BIND_10(T, a, ...) JSONXX_BIND_FIELD(T, a), JSONXX_BIND_9(T, __VA_ARGS__)
+#define JSONXX_BIND_11(T, a, ...) JSONXX_BIND_FIELD(T, a), JSONXX_BIND_10(T, __VA_ARGS__)
+#define JSONXX_BIND_12(T, a, ...) JSONXX_BIND_FIELD(T, a), JSONXX_BIND_11(T, __VA_ARGS__)
+#define JSONXX_BIND_13(T, a, ...) JSONXX_BIND_FIELD(T, a), JSONXX_BIND_12(T, __VA_ARGS__)
+#define JSONXX_BIND_14(T, a, ...) JSONXX_BIND_FIELD(T, a), JSONXX_BIND_13(T, __VA_ARGS__)
+#define JSONXX_BIND_15(T, a, ...) JSONXX_BIND_FIELD(T, a), JSONXX_BIND_14(T, __VA_ARGS__)
+#define JSONXX_BIND_16(T, a, ...) JSONXX_BIND_FIELD(T, a), JSONXX_BIND_15(T, __VA_ARGS__)
+
+#define JSONXX_BIND_NARG(...) \
+  JSONXX_BIND_NARG_(__VA_ARGS__, 16, 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1)
+#define JSONXX_BIND_NARG_(_1, _2, _3, _4, _5, _6, _7, _8, _9, _10, _11, _12, _13, _14, _15, _16, N, ...) N
+#define JSONXX_BIND_JOIN(a, b) JSONXX_BIND_JOIN_(a, b)
+#define JSONXX_BIND_JOIN_(a, b) a##b
+#define JSONXX_BIND_FIELDS(T, ...) \
+  JSONXX_BIND_JOIN(JSONXX_BIND_, JSONXX_BIND_NARG(__VA_ARGS__))(T, __VA_ARGS__)
+
+#define JSONXX_BIND(Type, ...) \
+  namespace jsonxx { \
+  template <> struct binding<Type> { \
+    static const bound_field<Type> *fields(size_t &count) { \
+      static const bound_field<Type> table[] = { JSONXX_BIND_FIELDS(Type, __VA_ARGS__) }; \
+      count = sizeof(table) / sizeof(table[0]); \
+      return table; \
+    } \
+  }; \
+  }
+
+#endif  // JSONXX_COMPILER_HAS_CXX11
+
+// Buffered output sink for the streaming serializer: bytes collect in a
+// fixed buffer and reach the backend in large writes, so documents of
+// any size serialize in O(1) extra memory. write() reports backend
+// failures; call flush() (or let the derived destructor do it) when done.
+class Sink {
+ public:
+  Sink() : used_(0) {}
+  virtual ~Sink() {}
+
+  bool write(const char *data, size_t size);
+  bool write(const std::string &s) { return write(s.data(), s.size()); }
+  bool put(char ch);
+  bool flush();
+
+ protected:
+  virtual bool write_bytes(const char *data, size_t size) = 0;
+
+ private:
+  enum { BUFFER_SIZE = 8192 };
+  char buffer_[BUFFER_SIZE];
+  size_t used_;
+  Sink(const Sink&);
+  Sink &operator=(const Sink&);
+};
+
+class StreamSink : public Sink {
+ public:
+  explicit StreamSink(std::ostream &out) : out_(out) {}
+  ~StreamSink() { flush(); }
+ protected:
+  bool write_bytes(const char *data, size_t size);
+ private:
+  std::ostream &out_;
+};
+
+class FileSink : public Sink {
+ public:
+  explicit FileSink(std::FILE *file) : file_(file) {}
+  ~FileSink() { flush(); }
+ protected:
+  bool write_bytes(const char *data, size_t size);
+ private:
+  std::FILE *file_;
+};
+
+class FdSink : public Sink {
+ public:
+  explicit FdSink(int fd) : fd_(fd) {}
+  ~FdSink() { flush(); }
+ protected:
+  bool write_bytes(const char *data, size_t size);
+ private:
+  int fd_;
+};
+
+class StringSink : public Sink {
+ public:
+  explicit StringSink(std::string &out) : out_(out) {}
+  ~StringSink() { flush(); }
+ protected:
+  bool write_bytes(const char *data, size_t size);
+ private:
+  std::string &out_;
+};
+
+// A compiled query path. Accepts JSON Pointer ("/response/items/3/price")
+// or dotted syntax ("response.items[3].price"); compile once and evaluate
+// against any number of documents with Object::query() without re-parsing
+// the path text.
+class Path {
+ public:
+  Path();
+  explicit Path(const char *path);
+  explicit Path(const std::string &path);
+
+  bool compile(const char *path);
+  bool valid() const;
+  size_t size() const;
+
+ private:
+  friend class Object;
+  struct Token {
+    std::string key;
+    size_t index;
+    bool is_index;   // digits-only or [n]: may address an array element
+  };
+  std::vector<Token> tokens_;
+  bool valid_;
+};
+
+// Serialized-bytes snapshot an Object/Array carries once cache_json()
+// opts it in: the node's body as last rendered (no key prologue, no root
+// trailer) plus the flavor it was rendered in, so the serializer only
+// reuses it for the same mode and indentation level. 'valid' flips false
+// whenever a mutating API touches the node.
+struct JsonCache {
+  JsonCache() : valid(false), pretty(true), depth(0) {}
+  std::string bytes;
+  bool valid;
+  bool pretty;
+  unsigned depth;
+};
+
+// Shared immutable subtree. Freezing a value pays one deep copy (lazy
+// slices materialize first, so a snapshot never depends on the original
+// input buffer); every attachment after that is O(1) -- a Value holding
+// a Shared payload bumps a refcount instead of copying, so one large
+// reference tree can sit in thousands of documents at the cost of one.
+// Const access reads the frozen tree in place; the first mutating access
+// detaches a private deep copy (copy-on-write), leaving every other
+// holder alone. With C++11 the refcount is atomic and reader threads
+// need no locks; pre-C++11 it degrades to a plain counter and
+// cross-thread sharing needs external synchronization, same as
+// intern(). The in-place normalizations const reads perform elsewhere
+// in the library -- get<String>() on an inline short string,
+// get<Number>() on an integer -- are done once at freeze time instead,
+// so const traversal of a frozen tree never writes to it.
+class Shared {
+ public:
+  Shared() : node_(0) {}
+  // the one deep copy; attaching the result anywhere is O(1) after this
+  explicit Shared(const Value &snapshot);
+  explicit Shared(const Object &snapshot);
+  explicit Shared(const Array &snapshot);
+  Shared(const Shared &other);
+  Shared &operator=(const Shared &other);
+  ~Shared();
+
+  bool empty() const { return !node_; }
+  // read-only view of the frozen subtree
+  const Value &value() const;
+  // holders of this snapshot, this handle included; 0 when empty
+  long use_count() const;
+  void reset();
+
+ private:
+  friend class Value;
+  struct Node;
+  static Node *ref(Node *node);
+  static void unref(Node *node);
+  Node *node_;
+};
+
 // A JSON Object
 class Object {
  public:
@@ -103,18 +642,92 @@ class Object {
   template <typename T>
   const T& get(const std::string& key, const typename identity<T>::type& default_value) const;
 
+  // Single-lookup access: the untyped node, or 0 when the key is missing.
+  Value *find(const std::string& key);
+  const Value *find(const std::string& key) const;
+
+  // Direct emplacement: returns a freshly reset slot for 'key' (reusing
+  // the existing node if the key is present), so a field can be patched
+  // in place -- set("n") = 42 -- without any intermediate deep copy.
+  Value &set(const std::string& key);
+
+  // Single-lookup typed access: 0 when the key is missing or holds a
+  // different type. No assertions, so safe reads need no has<>() probe.
+  template <typename T>
+  const T* try_get(const std::string& key) const;
+
   size_t size() const;
   bool empty() const;
 
-  const std::map<std::string, Value*>& kv_map() const;
+  // Walk a path into the document with one lookup per level. Returns 0
+  // if any step is missing or of the wrong shape.
+  Value *query(const Path &path);
+  Value *query(const char *path);   // convenience: compiles on every call
+  const Value *query(const Path &path) const;
+  const Value *query(const char *path) const;
+
+#if defined(JSONXX_UNORDERED_OBJECT) && JSONXX_COMPILER_HAS_CXX11 > 0
+  typedef std::unordered_map<std::string, Value*> container;
+#else
+  typedef std::map<std::string, Value*> container;
+#endif
+
+  typedef std::vector<container::value_type*> ordering;
+
+  const container& kv_map() const;
+  const ordering& kv_order() const;    // entries in insertion order
+  // Capacity hint for the insertion-order vector (and the hash table when
+  // JSONXX_UNORDERED_OBJECT is defined); std::map has nothing to reserve.
+  void reserve(size_t n);
   std::string json() const;
+  void json( std::string &out ) const;   // appends into a caller-provided buffer
+  void json( std::ostream &out ) const;
+  bool json( Sink &out, bool pretty = true ) const;   // streaming, O(1) extra memory
+  // Opt-in serialization cache: after cache_json(), repeated json() calls
+  // on an unchanged node reuse the stored bytes, and a parent's walk
+  // splices a clean cached child in instead of re-walking its subtree --
+  // fan-out serialization of a mostly-unchanged document costs one walk,
+  // not one per subscriber. Mutating APIs (and non-const lookups, which
+  // hand out mutable nodes) invalidate the node they run on, so reaching
+  // a nested node through non-const accessors dirties the whole access
+  // path. A long-lived Value* kept from query() sidesteps that trail;
+  // after writing through one, call cache_json() again to re-arm.
+  void cache_json( bool enabled = true );
+  JsonCache *json_cache() const { return cache_; }   // internal: serializer hook
   std::string xml( unsigned format = JSONx, const std::string &header = std::string(), const std::string &attrib = std::string() ) const;
   std::string write( unsigned format ) const;
 
   void reset();
   bool parse(std::istream &input);
   bool parse(const std::string &input);
-  typedef std::map<std::string, Value*> container;
+  bool parse(const char *begin, const char *end);
+  bool parse(const char *data, size_t size);
+  bool parse(const std::string &input, Arena &arena);
+  bool parse(const char *begin, const char *end, Arena &arena);
+  bool parse(const char *data, size_t size, Arena &arena);
+  // Lazy flavor: nested containers are kept as raw slices of the input
+  // and only parsed on first access, so a few top-level fields can be
+  // read without materializing the rest of the document. The input
+  // buffer must outlive the document.
+  bool parse_lazy(const std::string &input);
+  bool parse_lazy(const char *begin, const char *end);
+  bool parse_lazy(const char *data, size_t size);
+  bool parse_lazy(const std::string &input, Arena &arena);
+  bool parse_lazy(const char *begin, const char *end, Arena &arena);
+  bool parse_lazy(const char *data, size_t size, Arena &arena);
+  // Budgeted flavor for untrusted input: see ParseOptions.
+  bool parse(const std::string &input, const ParseOptions &options);
+  bool parse(const char *begin, const char *end, const ParseOptions &options);
+  bool parse(const char *data, size_t size, const ParseOptions &options);
+  static bool parse(const char*& cur, const char* end, Object& object, Arena *arena = 0, bool lazy = false, ParseState *state = 0);
+  // Binary snapshot: typed nodes with length-prefixed strings, written
+  // sequentially so no re-tokenizing happens on load. Same-architecture
+  // format (native endianness and long double layout) — a boot-time
+  // cache, not an interchange format.
+  bool save_binary(std::ostream &out) const;
+  bool load_binary(std::istream &in);
+  static bool write_binary(std::ostream &out, const Object &object);
+  static bool read_binary(std::istream &in, Object &object);
   void import( const Object &other );
   void import( const std::string &key, const Value &value );
   Object &operator<<(const Value &value);
@@ -123,16 +736,38 @@ class Object {
   Object(const Object &other);
   Object(const std::string &key, const Value &value);
   template<size_t N>
-  Object(const char (&key)[N], const Value &value) {
+  Object(const char (&key)[N], const Value &value) : cache_(0) {
     import(key,value);
   }
+#if JSONXX_COMPILER_HAS_CXX11 > 0
+  Object(Object &&other);
+  Object &operator=(Object &&other);
+  void import( Object &&other );
+  void import( const std::string &key, Value &&value );
+  Object &operator<<(Value &&value);
+#endif
   template<typename T>
   Object &operator<<(const T &value);
 
  protected:
   static bool parse(std::istream& input, Object& object);
+  // the iterative char engine files parsed values through assign()
+  friend bool parse_iterative(const char*&, const char*, Object*, Array*, Arena*, bool, ParseState*);
+  // teardown and deep copy drain children through explicit stacks, so
+  // trees as deep as the iterative parser builds die and copy without
+  // recursing once per level
+  friend void destroy_tree(std::vector<Value*>&);
+  friend void copy_tree(const Object*, const Array*, Object*, Array*);
+  // Sole insertion point: keeps value_map_ and order_ in sync. Returns
+  // the (possibly fresh, null) slot for the key; callers own disposing
+  // of any previous value before overwriting it.
+  Value *&assign(const std::string &key);
+  // flips the serialization cache stale; every mutating path lands here
+  void touch() { if (cache_) cache_->valid = false; }
   container value_map_;
+  ordering order_;
   std::string odd;
+  mutable JsonCache *cache_;
 };
 
 class Array {
@@ -158,24 +793,72 @@ class Array {
     return values_;
   }
   std::string json() const;
+  void json( std::string &out ) const;   // appends into a caller-provided buffer
+  void json( std::ostream &out ) const;
+  bool json( Sink &out, bool pretty = true ) const;   // streaming, O(1) extra memory
+  // Opt-in serialization cache: see Object::cache_json.
+  void cache_json( bool enabled = true );
+  JsonCache *json_cache() const { return cache_; }   // internal: serializer hook
   std::string xml( unsigned format = JSONx, const std::string &header = std::string(), const std::string &attrib = std::string() ) const;
 
   std::string write( unsigned format ) const { return format == JSON ? json() : xml(format); }
   void reset();
   bool parse(std::istream &input);
   bool parse(const std::string &input);
+  bool parse(const char *begin, const char *end);
+  bool parse(const char *data, size_t size);
+  bool parse(const std::string &input, Arena &arena);
+  bool parse(const char *begin, const char *end, Arena &arena);
+  bool parse(const char *data, size_t size, Arena &arena);
+  // Budgeted flavor for untrusted input: see ParseOptions.
+  bool parse(const std::string &input, const ParseOptions &options);
+  bool parse(const char *begin, const char *end, const ParseOptions &options);
+  bool parse(const char *data, size_t size, const ParseOptions &options);
+  static bool parse(const char*& cur, const char* end, Array& array, Arena *arena = 0, bool lazy = false, ParseState *state = 0);
+  // Binary snapshot: see Object::save_binary.
+  bool save_binary(std::ostream &out) const;
+  bool load_binary(std::istream &in);
+  static bool write_binary(std::ostream &out, const Array &array);
+  static bool read_binary(std::istream &in, Array &array);
   typedef std::vector<Value*> container;
+  // Capacity hint: pre-sizes the pointer vector. It survives the reset()
+  // at the start of parse(), so calling it before parsing a known-large
+  // array skips the reallocation ramp.
+  void reserve(size_t n);
+  // Direct emplacement: appends and returns a fresh slot, so an element
+  // can be built in place without an intermediate deep copy.
+  Value &emplace_back();
   void import(const Array &other);
   void import(const Value &value);
+  // Bulk load: appends one element per item in [begin, end), converting
+  // through Value::import() (numbers, bools, strings, containers). The
+  // vector is reserved once up front.
+  template <typename Iterator>
+  void import(Iterator begin, Iterator end);
   Array &operator<<(const Array &other);
   Array &operator<<(const Value &value);
   Array &operator=(const Array &other);
   Array &operator=(const Value &value);
   Array(const Array &other);
   Array(const Value &value);
+#if JSONXX_COMPILER_HAS_CXX11 > 0
+  Array(Array &&other);
+  Array &operator=(Array &&other);
+  void import(Array &&other);
+  void import(Value &&value);
+  Array &operator<<(Value &&value);
+#endif
  protected:
   static bool parse(std::istream& input, Array& array);
+  // the iterative char engine appends into values_ directly
+  friend bool parse_iterative(const char*&, const char*, Object*, Array*, Arena*, bool, ParseState*);
+  // see Object: iterative teardown and deep copy
+  friend void destroy_tree(std::vector<Value*>&);
+  friend void copy_tree(const Object*, const Array*, Object*, Array*);
+  // flips the serialization cache stale; every mutating path lands here
+  void touch() { if (cache_) cache_->valid = false; }
   container values_;
+  mutable JsonCache *cache_;
 };
 
 // A value could be a number, an array, a string, an object, a
@@ -199,20 +882,36 @@ class Value {
     type_ = BOOL_;
     bool_value_ = b;
   }
+#define $integer(TYPE) \
+  void import( const TYPE &n ) { \
+    reset(); \
+    type_ = INT_; \
+    int_value_ = (long long)(n); \
+  }
+  $integer( char )
+  $integer( int )
+  $integer( long )
+  $integer( long long )
+  $integer( unsigned char )
+  $integer( unsigned int )
+  $integer( unsigned long )
+#undef $integer
+  void import( const unsigned long long &n ) {
+    reset();
+    if( n <= (unsigned long long)(LLONG_MAX) ) {
+      type_ = INT_;
+      int_value_ = (long long)(n);
+    } else {
+      type_ = NUMBER_;
+      number_value_ = (Number)(n);
+    }
+  }
 #define $number(TYPE) \
   void import( const TYPE &n ) { \
     reset(); \
     type_ = NUMBER_; \
     number_value_ = n; \
   }
-  $number( char )
-  $number( int )
-  $number( long )
-  $number( long long )
-  $number( unsigned char )
-  $number( unsigned int )
-  $number( unsigned long )
-  $number( unsigned long long )
   $number( float )
   $number( double )
   $number( long double )
@@ -229,19 +928,48 @@ class Value {
   }
   void import( const String &s ) {
     reset();
-    type_ = STRING_;
-    *( string_value_ = new String() ) = s;
+    if (s.size() <= (size_t)SSTRING_CAPACITY) {
+      type_ = SSTRING_;
+      set_sstring(s.data(), s.size());
+    } else {
+      type_ = STRING_;
+      *( string_value_ = make_string() ) = s;
+    }
   }
   void import( const Array &a ) {
     reset();
     type_ = ARRAY_;
-    *( array_value_ = new Array() ) = a;
+    *( array_value_ = make_array() ) = a;
   }
   void import( const Object &o ) {
     reset();
     type_ = OBJECT_;
-    *( object_value_ = new Object() ) = o;
+    *( object_value_ = make_object() ) = o;
   }
+  void import( const Shared &shared );   // O(1): bumps the refcount
+#if JSONXX_COMPILER_HAS_CXX11 > 0
+  void import( String &&s ) {
+    reset();
+    if (s.size() <= (size_t)SSTRING_CAPACITY) {
+      type_ = SSTRING_;
+      set_sstring(s.data(), s.size());
+    } else {
+      type_ = STRING_;
+      *( string_value_ = make_string() ) = std::move(s);
+    }
+  }
+  void import( Array &&a ) {
+    reset();
+    type_ = ARRAY_;
+    *( array_value_ = make_array() ) = std::move(a);
+  }
+  void import( Object &&o ) {
+    reset();
+    type_ = OBJECT_;
+    *( object_value_ = make_object() ) = std::move(o);
+  }
+  void import( Value &&other );
+#endif
   void import( const Value &other ) {
     if (this != &other)
     switch (other.type_) {
@@ -254,15 +982,34 @@ class Value {
       case NUMBER_:
         import( other.number_value_ );
         break;
+      case INT_:
+        import( other.int_value_ );
+        break;
       case STRING_:
         import( *other.string_value_ );
         break;
+      case SSTRING_:
+        reset();
+        type_ = SSTRING_;
+        std::memcpy( sstring_value_, other.sstring_value_, sizeof(sstring_value_) );
+        break;
+      case RAW_:
+        reset();
+        type_ = RAW_;
+        raw_value_ = other.raw_value_;
+        break;
       case ARRAY_:
         import( *other.array_value_ );
         break;
       case OBJECT_:
         import( *other.object_value_ );
         break;
+      case SHARED_:
+        // O(1): the copy shares the frozen subtree too
+        reset();
+        type_ = SHARED_;
+        shared_value_ = Shared::ref( other.shared_value_ );
+        break;
       case INVALID_:
         type_ = INVALID_;
         break;
@@ -282,13 +1029,54 @@ class Value {
     return *this;
   }
   Value(const Value &other);
+  Value &operator=(const Value &other) {
+    if (this != &other) {
+      reset();
+      import(other);
+    }
+    return *this;
+  }
+#if JSONXX_COMPILER_HAS_CXX11 > 0
+  Value(Value &&other) : type_(INVALID_), arena_(0) { import( std::move(other) ); }
+  Value(String &&s) : type_(INVALID_), arena_(0) { import( std::move(s) ); }
+  Value(Array &&a) : type_(INVALID_), arena_(0) { import( std::move(a) ); }
+  Value(Object &&o) : type_(INVALID_), arena_(0) { import( std::move(o) ); }
+  Value &operator=(Value &&other) {
+    import( std::move(other) );
+    return *this;
+  }
+#endif
   template<typename T>
-  Value( const T&t ) : type_(INVALID_) { import(t); }
+  Value( const T&t ) : type_(INVALID_), arena_(0) { import(t); }
   template<size_t N>
-  Value( const char (&t)[N] ) : type_(INVALID_) { import( std::string(t) ); }
+  Value( const char (&t)[N] ) : type_(INVALID_), arena_(0) { import( std::string(t) ); }
 
   bool parse(std::istream &input);
   bool parse(const std::string &input);
+  bool parse(const char *begin, const char *end);
+  bool parse(const char *data, size_t size);
+  bool parse(const std::string &input, Arena &arena);
+  bool parse(const char *begin, const char *end, Arena &arena);
+  bool parse(const char *data, size_t size, Arena &arena);
+  // Lazy flavor: see Object::parse_lazy. The input buffer must outlive
+  // the value.
+  bool parse_lazy(const std::string &input);
+  bool parse_lazy(const char *begin, const char *end);
+  bool parse_lazy(const char *data, size_t size);
+  bool parse_lazy(const std::string &input, Arena &arena);
+  bool parse_lazy(const char *begin, const char *end, Arena &arena);
+  bool parse_lazy(const char *data, size_t size, Arena &arena);
+  // Budgeted flavor for untrusted input: see ParseOptions.
+  bool parse(const std::string &input, const ParseOptions &options);
+  bool parse(const char *begin, const char *end, const ParseOptions &options);
+  bool parse(const char *data, size_t size, const ParseOptions &options);
+  static bool parse(const char*& cur, const char* end, Value& value, bool lazy = false, ParseState *state = 0);
+  // Binary snapshot: see Object::save_binary.
+  bool save_binary(std::ostream &out) const;
+  bool load_binary(std::istream &in);
+  static bool write_binary(std::ostream &out, const Value& value);
+  static bool read_binary(std::istream &in, Value& value);
+  bool json( Sink &out, bool pretty = true ) const;   // streaming, O(1) extra memory
 
   template<typename T>
   bool is() const;
@@ -302,25 +1090,128 @@ class Value {
  public:
   enum {
     NUMBER_,
+    INT_,
     STRING_,
+    SSTRING_,   // short string stored inline in the union
     BOOL_,
     NULL_,
     ARRAY_,
     OBJECT_,
+    RAW_,       // unparsed slice of the input buffer (lazy mode)
+    SHARED_,    // refcounted frozen subtree (see class Shared)
     INVALID_
   } type_;
+  // Strings no longer than this live inline in sstring_value_ with no
+  // heap node; the length rides in the last byte of the buffer.
+  enum { SSTRING_CAPACITY = 23 };
+  struct Slice {
+    const char *begin;
+    const char *end;
+  };
   union {
     Number number_value_;
+    long long int_value_;
     String* string_value_;
+    char sstring_value_[SSTRING_CAPACITY + 1];
     Boolean bool_value_;
     Array* array_value_;
     Object* object_value_;
+    Slice raw_value_;    // always starts at the container's '{' or '['
+    Shared::Node* shared_value_;   // refcounted; never arena memory
   };
+  const char *sstring_data() const { return sstring_value_; }
+  size_t sstring_size() const { return (size_t)(unsigned char)sstring_value_[SSTRING_CAPACITY]; }
+  // Parse a RAW_ slice into a real Object/Array node. is<>()/get<>() and
+  // the serializers call this on first access; children stay lazy.
+  void materialize();
+  // Look through a SHARED_ payload to the frozen tree; identity for
+  // every other type.
+  const Value &deref() const;
+  // Replace a SHARED_ payload with a privately owned deep copy
+  // (copy-on-write); the mutable get<>() accessors call this first.
+  void detach();
+  // arena this node was carved out of, if any; children are then
+  // arena-owned too and reset() leaves them to the arena
+  Arena* arena_;
 
 protected:
   static bool parse(std::istream& input, Value& value);
+  // the iterative char engine builds scalars and containers in place
+  friend bool parse_iterative(const char*&, const char*, Object*, Array*, Arena*, bool, ParseState*);
+  // the iterative deep copy builds container payloads in place too
+  friend void copy_tree(const Object*, const Array*, Object*, Array*);
+  void set_sstring(const char *data, size_t size) {
+    JSONXX_ASSERT(size <= (size_t)SSTRING_CAPACITY);
+    std::memcpy(sstring_value_, data, size);
+    sstring_value_[SSTRING_CAPACITY] = (char)(unsigned char)size;
+  }
+  String *make_string();
+  Array *make_array();
+  Object *make_object();
 };
 
+// Defined out of line: the payload is a full Value, which is only
+// complete here.
+struct Shared::Node {
+  Node() : refs(1) {}
+#if JSONXX_COMPILER_HAS_CXX11 > 0
+  std::atomic<long> refs;   // lock-free: readers share without locks
+#else
+  long refs;   // pre-C++11: synchronize cross-thread sharing externally
+#endif
+  Value value;              // frozen; never mutated after construction
+};
+
+inline Shared::Node *Shared::ref(Node *node) {
+  if (node) ++node->refs;
+  return node;
+}
+
+inline void Shared::unref(Node *node) {
+  if (node && --node->refs == 0) delete node;
+}
+
+inline Shared::Shared(const Shared &other) : node_(ref(other.node_)) {}
+
+inline Shared &Shared::operator=(const Shared &other) {
+  // ref first: self-assignment must not drop the last reference
+  Node *node = ref(other.node_);
+  unref(node_);
+  node_ = node;
+  return *this;
+}
+
+inline Shared::~Shared() { unref(node_); }
+
+inline void Shared::reset() {
+  unref(node_);
+  node_ = 0;
+}
+
+inline const Value &Shared::value() const {
+  JSONXX_ASSERT(node_);
+  return node_->value;
+}
+
+inline long Shared::use_count() const {
+  return node_ ? (long)node_->refs : 0;
+}
+
+inline const Value &Value::deref() const {
+  // a Node payload is never itself SHARED_, so one hop suffices
+  return type_ == SHARED_ ? shared_value_->value : *this;
+}
+
+inline void Value::import(const Shared &shared) {
+  reset();
+  if (!shared.node_) {   // an empty handle reads as null
+    type_ = NULL_;
+    return;
+  }
+  type_ = SHARED_;
+  shared_value_ = Shared::ref(shared.node_);
+}
+
 template <typename T>
 bool Array::has(unsigned int i) const {
   if (i >= size()) {
@@ -334,6 +1225,7 @@ bool Array::has(unsigned int i) const {
 template <typename T>
 T& Array::get(unsigned int i) {
   JSONXX_ASSERT(i < size());
+  touch();   // the caller may mutate through the reference
   Value* v = values_.at(i);
   return v->get<T>();
 }
@@ -355,6 +1247,17 @@ const T& Array::get(unsigned int i, const typename identity<T>::type& default_va
   }
 }
 
+template <typename Iterator>
+void Array::import(Iterator begin, Iterator end) {
+  touch();
+  values_.reserve(values_.size() + (size_t)std::distance(begin, end));
+  for (; begin != end; ++begin) {
+    Value *v = new Value();
+    v->import(*begin);
+    values_.push_back(v);
+  }
+}
+
 template <typename T>
 bool Object::has(const std::string& key) const {
   container::const_iterator it(value_map_.find(key));
@@ -363,113 +1266,174 @@ bool Object::has(const std::string& key) const {
 
 template <typename T>
 T& Object::get(const std::string& key) {
-  JSONXX_ASSERT(has<T>(key));
-  return value_map_.find(key)->second->get<T>();
+  Value* v = find(key);
+  JSONXX_ASSERT(v && v->is<T>());
+  return v->get<T>();
 }
 
 template <typename T>
 const T& Object::get(const std::string& key) const {
-  JSONXX_ASSERT(has<T>(key));
-  return value_map_.find(key)->second->get<T>();
+  const Value* v = find(key);
+  JSONXX_ASSERT(v && v->is<T>());
+  return v->get<T>();
+}
+
+template <typename T>
+const T* Object::try_get(const std::string& key) const {
+  const Value* v = find(key);
+  return v && v->is<T>() ? &v->get<T>() : 0;
 }
 
 template <typename T>
 const T& Object::get(const std::string& key, const typename identity<T>::type& default_value) const {
-  if (has<T>(key)) {
-    return value_map_.find(key)->second->get<T>();
-  } else {
-    return default_value;
-  }
+  const T* v = try_get<T>(key);
+  return v ? *v : default_value;
 }
 
 template<>
 inline bool Value::is<Null>() const {
+  if (type_ == SHARED_) return deref().is<Null>();
   return type_ == NULL_;
 }
 
 template<>
 inline bool Value::is<Boolean>() const {
+  if (type_ == SHARED_) return deref().is<Boolean>();
   return type_ == BOOL_;
 }
 
 template<>
 inline bool Value::is<String>() const {
-  return type_ == STRING_;
+  if (type_ == SHARED_) return deref().is<String>();
+  return type_ == STRING_ || type_ == SSTRING_;
 }
 
 template<>
 inline bool Value::is<Number>() const {
-  return type_ == NUMBER_;
+  if (type_ == SHARED_) return deref().is<Number>();
+  return type_ == NUMBER_ || type_ == INT_;
+}
+
+template<>
+inline bool Value::is<Integer>() const {
+  if (type_ == SHARED_) return deref().is<Integer>();
+  return type_ == INT_;
 }
 
 template<>
 inline bool Value::is<Array>() const {
-  return type_ == ARRAY_;
+  if (type_ == SHARED_) return deref().is<Array>();
+  return type_ == ARRAY_ || (type_ == RAW_ && *raw_value_.begin == '[');
 }
 
 template<>
 inline bool Value::is<Object>() const {
-  return type_ == OBJECT_;
+  if (type_ == SHARED_) return deref().is<Object>();
+  return type_ == OBJECT_ || (type_ == RAW_ && *raw_value_.begin == '{');
 }
 
 template<>
 inline bool& Value::get<Boolean>() {
   JSONXX_ASSERT(is<Boolean>());
+  if (type_ == SHARED_) detach();   // copy-on-write: mutable access
   return bool_value_;
 }
 
 template<>
 inline std::string& Value::get<String>() {
   JSONXX_ASSERT(is<String>());
+  if (type_ == SHARED_) detach();   // copy-on-write: mutable access
+  if (type_ == SSTRING_) {
+    // materialize lazily: the union cannot hand out a std::string&.
+    // Copy the inline bytes out first; they share storage with the pointer.
+    String copy(sstring_value_, sstring_size());
+    ( string_value_ = make_string() )->swap(copy);
+    type_ = STRING_;
+  }
   return *string_value_;
 }
 
 template<>
 inline Number& Value::get<Number>() {
   JSONXX_ASSERT(is<Number>());
+  if (type_ == SHARED_) detach();   // copy-on-write: mutable access
+  if (type_ == INT_) {
+    // normalize lazily; int_value_ and number_value_ share storage
+    long long i = int_value_;
+    number_value_ = (Number)(i);
+    type_ = NUMBER_;
+  }
   return number_value_;
 }
 
+template<>
+inline Integer& Value::get<Integer>() {
+  JSONXX_ASSERT(is<Integer>());
+  if (type_ == SHARED_) detach();   // copy-on-write: mutable access
+  return int_value_;
+}
+
 template<>
 inline Array& Value::get<Array>() {
   JSONXX_ASSERT(is<Array>());
+  if (type_ == SHARED_) detach();   // copy-on-write: mutable access
+  if (type_ == RAW_) materialize();
   return *array_value_;
 }
 
 template<>
 inline Object& Value::get<Object>() {
   JSONXX_ASSERT(is<Object>());
+  if (type_ == SHARED_) detach();   // copy-on-write: mutable access
+  if (type_ == RAW_) materialize();
   return *object_value_;
 }
 
 template<>
 inline const Boolean& Value::get<Boolean>() const {
   JSONXX_ASSERT(is<Boolean>());
+  if (type_ == SHARED_) return deref().get<Boolean>();   // read-only: no detach
   return bool_value_;
 }
 
 template<>
 inline const String& Value::get<String>() const {
   JSONXX_ASSERT(is<String>());
-  return *string_value_;
+  if (type_ == SHARED_) return deref().get<String>();   // read-only: no detach
+  // same lazy materialization as the mutable overload, so the returned
+  // reference stays valid for the caller
+  return const_cast<Value*>(this)->get<String>();
 }
 
 template<>
 inline const Number& Value::get<Number>() const {
   JSONXX_ASSERT(is<Number>());
-  return number_value_;
+  if (type_ == SHARED_) return deref().get<Number>();   // read-only: no detach
+  // same lazy normalization as the mutable overload, so the returned
+  // reference stays valid for the caller
+  return const_cast<Value*>(this)->get<Number>();
+}
+
+template<>
+inline const Integer& Value::get<Integer>() const {
+  JSONXX_ASSERT(is<Integer>());
+  if (type_ == SHARED_) return deref().get<Integer>();   // read-only: no detach
+  return int_value_;
 }
 
 template<>
 inline const Array& Value::get<Array>() const {
   JSONXX_ASSERT(is<Array>());
-  return *array_value_;
+  if (type_ == SHARED_) return deref().get<Array>();   // read-only: no detach
+  // lazy slices materialize in place, same as get<Number>() for INT_
+  return const_cast<Value*>(this)->get<Array>();
 }
 
 template<>
 inline const Object& Value::get<Object>() const {
   JSONXX_ASSERT(is<Object>());
-  return *object_value_;
+  if (type_ == SHARED_) return deref().get<Object>();   // read-only: no detach
+  return const_cast<Value*>(this)->get<Object>();
 }
 
 template<typename T>
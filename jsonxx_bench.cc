@@ -0,0 +1,183 @@
+// Performance harness for jsonxx. Measures parse/serialize throughput,
+// peak RSS and heap allocation counts over a few representative document
+// shapes. Build and run with 'make bench'.
+//
+// Author: r-lyeh, degrades to a simple timing loop on exotic platforms.
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <algorithm>
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <sys/resource.h>
+
+#include "jsonxx.h"
+
+namespace {
+
+// -- allocation counting ----------------------------------------------------
+
+size_t allocation_count = 0;
+
+}  // namespace
+
+void *operator new( size_t size ) {
+    ++allocation_count;
+    void *p = malloc( size );
+    if( !p ) abort();
+    return p;
+}
+
+void *operator new[]( size_t size ) {
+    return operator new( size );
+}
+
+void operator delete( void *p ) throw() {
+    free( p );
+}
+
+void operator delete[]( void *p ) throw() {
+    free( p );
+}
+
+#if JSONXX_COMPILER_HAS_CXX11 > 0 && __cplusplus >= 201402L
+void operator delete( void *p, size_t ) noexcept {
+    free( p );
+}
+
+void operator delete[]( void *p, size_t ) noexcept {
+    free( p );
+}
+#endif
+
+namespace {
+
+// -- timing -----------------------------------------------------------------
+
+double now_seconds() {
+    struct timespec ts;
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+size_t peak_rss_kb() {
+    struct rusage ru;
+    getrusage( RUSAGE_SELF, &ru );
+    return (size_t)ru.ru_maxrss;
+}
+
+struct sample_stats {
+    double median;
+    double stddev;
+};
+
+sample_stats summarize( std::vector<double> &samples ) {
+    std::sort( samples.begin(), samples.end() );
+    sample_stats s;
+    s.median = samples[ samples.size() / 2 ];
+    double mean = 0;
+    for( size_t i = 0; i < samples.size(); ++i ) mean += samples[i];
+    mean /= samples.size();
+    double var = 0;
+    for( size_t i = 0; i < samples.size(); ++i ) var += (samples[i] - mean) * (samples[i] - mean);
+    s.stddev = std::sqrt( var / samples.size() );
+    return s;
+}
+
+// -- corpora ----------------------------------------------------------------
+
+std::string number_heavy() {
+    std::ostringstream ss;
+    ss << "{\"samples\": [";
+    for( int i = 0; i < 50000; ++i )
+        ss << (i ? "," : "") << (i * 1103515245u % 100000u) << "." << (i % 1000);
+    ss << "]}";
+    return ss.str();
+}
+
+std::string string_heavy() {
+    std::ostringstream ss;
+    ss << "[";
+    for( int i = 0; i < 20000; ++i )
+        ss << (i ? "," : "") << "{\"level\": \"info\", \"msg\": \"request " << i
+           << " served from cache in 0.0" << (i % 97) << "ms \\\"ok\\\"\"}";
+    ss << "]";
+    return ss.str();
+}
+
+std::string deep_nesting() {
+    std::string doc;
+    const int depth = 200;
+    for( int i = 0; i < depth; ++i ) doc += "{\"child\": [";
+    doc += "0";
+    for( int i = 0; i < depth; ++i ) doc += "]}";
+    return doc;
+}
+
+std::string many_keys() {
+    std::ostringstream ss;
+    ss << "{";
+    for( int i = 0; i < 20000; ++i )
+        ss << (i ? "," : "") << "\"key_" << i << "\": " << i;
+    ss << "}";
+    return ss.str();
+}
+
+// -- benchmark driver -------------------------------------------------------
+
+const int warmup_runs = 2;
+const int timed_runs = 9;
+
+void bench_corpus( const char *name, const std::string &doc ) {
+    double mb = doc.size() / (1024.0 * 1024.0);
+
+    std::vector<double> parse_mbs, json_mbs;
+    size_t parse_allocs = 0;
+
+    for( int run = 0; run < warmup_runs + timed_runs; ++run ) {
+        jsonxx::Value v;
+
+        size_t allocs_before = allocation_count;
+        double t0 = now_seconds();
+        if( !v.parse( doc.data(), doc.data() + doc.size() ) ) {
+            fprintf( stderr, "%s: parse failed\n", name );
+            exit( 1 );
+        }
+        double t1 = now_seconds();
+
+        std::string out;
+        if( v.is<jsonxx::Object>() ) v.get<jsonxx::Object>().json( out );
+        else v.get<jsonxx::Array>().json( out );
+        double t2 = now_seconds();
+
+        if( run >= warmup_runs ) {
+            parse_mbs.push_back( mb / (t1 - t0) );
+            json_mbs.push_back( mb / (t2 - t1) );
+            parse_allocs = allocation_count - allocs_before;
+        }
+    }
+
+    sample_stats parse = summarize( parse_mbs );
+    sample_stats json = summarize( json_mbs );
+
+    printf( "%-14s %8.2f MB  parse %8.1f MB/s (+-%5.1f)  json %8.1f MB/s (+-%5.1f)  %9lu allocs  rss %lu KB\n",
+            name, mb,
+            parse.median, parse.stddev,
+            json.median, json.stddev,
+            (unsigned long)parse_allocs, (unsigned long)peak_rss_kb() );
+}
+
+}  // namespace
+
+int main() {
+    bench_corpus( "number-heavy", number_heavy() );
+    bench_corpus( "string-heavy", string_heavy() );
+    bench_corpus( "deep-nesting", deep_nesting() );
+    bench_corpus( "many-keys", many_keys() );
+    return 0;
+}
@@ -16,6 +16,10 @@ namespace jsonxx {
     extern bool parse_string(std::istream& input, String& value);
     extern bool parse_number(std::istream& input, Number& value);
     extern bool match(const char* pattern, std::istream& input);
+    struct ParseState;
+    extern bool parse_string(const char*& cur, const char* end, String& value, ParseState* state = 0);
+    extern bool parse_number(const char*& cur, const char* end, Number& value);
+    extern bool match(const char* pattern, const char*& cur, const char* end);
 }
 
 bool is_asserting() {
@@ -26,6 +30,48 @@ bool is_asserting() {
 
 struct custom_type {};      // Used in a test elsewhere
 
+// Used in the event-parser test: counts events and grabs one field
+struct field_extractor : jsonxx::ParseHandler {
+    field_extractor() : numbers(0), in_id(false) {}
+    bool key(const jsonxx::String &name) {
+        in_id = (name == "id");
+        return true;
+    }
+    bool string(const jsonxx::String &value) {
+        if (in_id) id = value;
+        return true;
+    }
+    bool number(jsonxx::Number) {
+        ++numbers;
+        return true;
+    }
+    int numbers;
+    bool in_id;
+    jsonxx::String id;
+};
+
+// Used in the deep-document test: tracks container nesting
+struct depth_tracker : jsonxx::ParseHandler {
+    depth_tracker() : depth(0), peak(0), numbers(0) {}
+    bool begin_object() { if (++depth > peak) peak = depth; return true; }
+    bool end_object() { --depth; return true; }
+    bool begin_array() { if (++depth > peak) peak = depth; return true; }
+    bool end_array() { --depth; return true; }
+    bool number(jsonxx::Number) { ++numbers; return true; }
+    int depth, peak, numbers;
+};
+
+#if JSONXX_COMPILER_HAS_CXX11 > 0
+// Used in the schema-binding test: a fixed-schema telemetry record
+struct telemetry_sample {
+    long long id = 0;
+    double load = 0;
+    std::string host;
+    bool healthy = false;
+};
+JSONXX_BIND(telemetry_sample, id, load, host, healthy)
+#endif
+
 int main(int argc, const char **argv) {
 
     if( !is_asserting() ) {
@@ -92,12 +138,37 @@ int main(int argc, const char **argv) {
         TEST(value == "field1");
     }
     {
-        // 'escaped text to unescaped text' test
+        // 'escaped text to unescaped text' test; \u escapes decode as hex
         string teststr("\"\\b\\f\\n\\r\\t\\u0014\\u0002\"");
         string value;
         istringstream input(teststr);
         TEST(parse_string(input, value));
-        TEST( value == "\b\f\n\r\t\xe\x2" );
+        TEST( value == "\b\f\n\r\t\x14\x2" );
+    }
+    {
+        // \u escapes emit UTF-8, combining surrogate pairs; unpaired
+        // surrogates and broken escapes become U+FFFD
+        string teststr("\"caf\\u00e9 \\u20ac \\uD83D\\uDE00\"");
+        string value;
+        istringstream input(teststr);
+        TEST(parse_string(input, value));
+        TEST( value == "caf\xc3\xa9 \xe2\x82\xac \xf0\x9f\x98\x80" );
+
+        value.clear();
+        const char *cur = teststr.data(), *end = teststr.data() + teststr.size();
+        TEST(parse_string(cur, end, value));   // char engine agrees
+        TEST( value == "caf\xc3\xa9 \xe2\x82\xac \xf0\x9f\x98\x80" );
+
+        string lone("\"\\uD83D!\"");
+        value.clear();
+        cur = lone.data(); end = lone.data() + lone.size();
+        TEST(parse_string(cur, end, value));
+        TEST( value == "\xef\xbf\xbd!" );
+
+        istringstream lone2("\"x\\uDC00\"");
+        value.clear();
+        TEST(parse_string(lone2, value));
+        TEST( value == "x\xef\xbf\xbd" );
     }
     {
         string teststr("6");
@@ -111,6 +182,59 @@ int main(int argc, const char **argv) {
         istringstream input(teststr);
         TEST(match("}", input));
     }
+    {
+        // char-range engine, same results as the istream one
+        string teststr("\"field1\"");
+        string value;
+        const char *cur = teststr.data(), *end = teststr.data() + teststr.size();
+        TEST(parse_string(cur, end, value));
+        TEST(value == "field1");
+    }
+    {
+        string teststr(" 42.5");
+        const char *cur = teststr.data(), *end = teststr.data() + teststr.size();
+        Number value;
+        TEST(parse_number(cur, end, value));
+        TEST(value == 42.5);
+    }
+    {
+        string teststr(" }");
+        const char *cur = teststr.data(), *end = teststr.data() + teststr.size();
+        TEST(match("}", cur, end));
+    }
+    {
+        string teststr("{ \"field1\" : 6 }");
+        Object o;
+        TEST(o.parse(teststr.data(), teststr.size()));
+        TEST(o.has<Number>("field1"));
+        TEST(6 == o.get<Number>("field1"));
+    }
+    {
+        // arena-backed parse: nodes are released in bulk by the arena
+        string teststr("{ \"foo\" : 1, \"bar\" : [true, \"baz\", 54.7] }");
+        Arena arena;
+        Object o;
+        TEST(o.parse(teststr, arena));
+        TEST(o.has<Number>("foo"));
+        TEST(o.has<Array>("bar"));
+        TEST(o.get<Array>("bar").get<String>(1) == "baz");
+        o.reset();
+        TEST(o.parse(teststr, arena));   // arena can be reused across parses
+        TEST(o.get<Array>("bar").get<Number>(2) - 54.7 < 1e-6);
+    }
+    {
+        // event-driven parse: no tree is materialized
+        string teststr("{ \"id\": \"abc123\", \"data\": [1, 2, 3], \"ok\": true }");
+        field_extractor handler;
+        TEST(parse_events(teststr, handler));
+        TEST(handler.id == "abc123");
+        TEST(handler.numbers == 3);
+    }
+    {
+        string teststr("{ \"field1 : 6 }");
+        field_extractor handler;
+        TEST(!parse_events(teststr, handler));
+    }
     {
         string teststr("{ \"field1\" : 6 }");
         istringstream input(teststr);
@@ -153,6 +277,594 @@ int main(int argc, const char **argv) {
         Value v;
         TEST(!v.parse(input));
     }
+    {
+        // long strings exercise the vectorized clean-run scanner
+        string body(1000, 'x');
+        body[17] = '\t';            // escape beyond the first 16-byte chunk
+        body += "tail \"quoted\" \\ done";
+        Object o;
+        o << "blob" << body;
+        Object p;
+        TEST(p.parse(o.json()));
+        TEST(p.get<String>("blob") == body);
+    }
+    {
+        // 64-bit integers parse and round-trip exactly
+        string teststr("{\"id\": 9223372036854775807, \"n\": -42, \"f\": 42.5}");
+        Object o;
+        TEST(o.parse(teststr));
+        TEST(o.has<Integer>("id"));
+        TEST(o.get<Integer>("id") == 9223372036854775807LL);
+        TEST(o.has<Number>("n"));       // integers still read back as Number
+        TEST(o.get<Number>("n") == -42);
+        TEST(!o.has<Integer>("f"));
+        TEST(o.has<Number>("f"));
+        TEST(o.json().find("9223372036854775807") != string::npos);
+    }
+    {
+        // in-place patching: set() and emplace_back() hand out mutable
+        // slots instead of deep-copying a temporary
+        Object o;
+        TEST(o.parse("{\"status\": \"new\", \"tries\": 1}"));
+        o.set("status") = String("forwarded");   // existing key: node reused
+        o.set("node") = 12;                  // new key
+        TEST(o.get<String>("status") == "forwarded");
+        TEST(o.get<Number>("node") == 12);
+        TEST(o.get<Number>("tries") == 1);
+
+        o.set("hops") = Array();
+        Array& hops = o.get<Array>("hops");
+        hops.emplace_back() = String("gw-1");
+        hops.emplace_back() = 7;
+        TEST(hops.size() == 2);
+        TEST(hops.get<String>(0) == "gw-1");
+        TEST(hops.get<Number>(1) == 7);
+        TEST(validate(o.json()));
+
+        // a slot left unassigned is inert: it reads empty and serializes
+        // as null rather than posing as its old type
+        TEST(o.set("status").empty());
+        TEST(o.json().find("\"status\": null") != string::npos);
+
+        // streaming with operator<< now copies the value once, not twice
+        Object p;
+        p << "key" << "value";
+        TEST(p.get<String>("key") == "value");
+    }
+    {
+        // reusable Parser/Writer contexts: one arena and one output
+        // buffer amortized over many documents
+        Reader parser;
+        Writer writer;
+        {
+            Object o;
+            TEST(parser.parse(string("{\"seq\": 1}"), o));
+            TEST(o.get<Number>("seq") == 1);
+            TEST(writer.json(o) == o.json());
+
+            Object p;
+            TEST(parser.parse(string("{\"seq\": 2}"), p));
+            TEST(p.get<Number>("seq") == 2);
+            TEST(o.get<Number>("seq") == 1);   // earlier doc still alive
+
+            Array a;
+            TEST(parser.parse(string("[1, 2, 3]"), a));
+            TEST(writer.json(a) == a.json());
+
+            Value v;
+            TEST(parser.parse(string("{\"deep\": [true]}"), v));
+            TEST(v.is<Object>());
+        }
+        parser.clear();   // batch-free after the borrowing documents die
+
+        parser.options().max_depth = 2;
+        Object o;
+        TEST(!parser.parse(string("{\"a\": {\"b\": {\"c\": 1}}}"), o));
+    }
+    {
+        // key interning: equal strings resolve to one pooled copy
+        const String& a = intern("request_id");
+        const String& b = intern(string("request_") + "id");
+        TEST(&a == &b);
+        TEST(a == "request_id");
+        TEST(&intern("other_key") != &a);
+    }
+    {
+        // single-lookup access: find() and try_get<>() instead of
+        // has<>() followed by get<>()
+        Object o;
+        TEST(o.parse("{\"port\": 8080, \"host\": \"alpha\", \"tls\": false}"));
+        Value* v = o.find("port");
+        TEST(v != NULL);
+        TEST(v->is<Number>());
+        TEST(o.find("missing") == NULL);
+
+        const Object& co = o;
+        TEST(co.find("host") != NULL);
+        const Number* port = co.try_get<Number>("port");
+        TEST(port != NULL);
+        TEST(*port == 8080);
+        TEST(co.try_get<String>("port") == NULL);     // wrong type
+        TEST(co.try_get<Boolean>("missing") == NULL);
+        TEST(co.get<Number>("port", 1) == 8080);
+        TEST(co.get<Number>("missing", 1) == 1);
+    }
+    {
+        // parse budgets reject hostile inputs early; 0 means unlimited
+        ParseOptions limits;
+        limits.max_depth = 4;
+        Object o;
+        TEST(o.parse(string("{\"a\": [[1]]}"), limits));            // depth 3
+        TEST(!o.parse(string("{\"a\": [[[[1]]]]}"), limits));       // depth 6
+
+        string bomb;
+        for (int i = 0; i < 1000; ++i) bomb += "[";
+        Array a;
+        TEST(!a.parse(bomb, limits));
+
+        ParseOptions small;
+        small.max_nodes = 3;
+        TEST(!a.parse(string("[1, 2, 3, 4]"), small));
+        TEST(a.parse(string("[1, 2, 3]"), small));
+
+        small = ParseOptions();
+        small.max_string = 8;
+        TEST(o.parse(string("{\"k\": \"12345678\"}"), small));
+        TEST(!o.parse(string("{\"k\": \"123456789\"}"), small));
+        TEST(!o.parse(string("{\"123456789\": 1}"), small));        // keys count too
+
+        small = ParseOptions();
+        small.max_bytes = 16;
+        TEST(!o.parse(string("{\"spread\": [1, 2, 3, 4, 5]}"), small));
+
+        Value v;
+        TEST(v.parse(string("{\"a\": 1}"), ParseOptions()));        // defaults: unlimited
+    }
+    {
+        // capacity hints and bulk loads
+        int ints[] = { 1, 2, 3, 4 };
+        Array a;
+        a.reserve(16);
+        a.import(ints, ints + 4);
+        TEST(a.size() == 4);
+        TEST(a.get<Number>(3) == 4);
+
+        vector<string> words;
+        words.push_back("alpha");
+        words.push_back("beta");
+        a.import(words.begin(), words.end());
+        TEST(a.size() == 6);
+        TEST(a.get<String>(5) == "beta");
+
+        // a caller-side reserve survives the reset() inside parse()
+        Array b;
+        b.reserve(1000);
+        TEST(b.parse(string("[1, 2, 3]")));
+        TEST(b.size() == 3);
+
+        Object o;
+        o.reserve(8);
+        o << "k" << 1;
+        TEST(o.get<Number>("k") == 1);
+    }
+    {
+        // validate() walks the input without building a document, but
+        // accepts exactly what the DOM parser accepts
+        TEST(validate(string("{\"a\": [1, 2.5e3, \"x\\\"y\"], \"b\": null}")));
+        TEST(validate(string("// comment\n{'single': true,}")));   // permissive quirks
+        TEST(!validate(string("[1, 2")));               // unterminated
+        TEST(!validate(string("{\"a\" 1}")));
+        TEST(!validate(string("true")));                // top level must be { or [
+        string deep;
+        for (int i = 0; i < 300; ++i) deep += "[";
+        deep += "0";
+        for (int i = 0; i < 300; ++i) deep += "]";
+        TEST(validate(deep));
+        TEST(validate(deep.data(), deep.size()));
+    }
+    {
+        // streaming serializer: incremental sinks match the buffered output
+        Object o;
+        TEST(o.parse("{\"name\": \"quoted \\\"text\\\"\", \"rows\": [1, 2.5, null], \"ok\": true}"));
+
+        string streamed;
+        StringSink sink(streamed);
+        TEST(o.json(sink));
+        TEST(streamed == o.json());     // pretty mode is byte-identical
+
+        ostringstream pretty;
+        o.json(pretty);                 // ostream overload now streams too
+        TEST(pretty.str() == o.json());
+
+        string compact;
+        StringSink compact_sink(compact);
+        TEST(o.json(compact_sink, false));
+        ostringstream op;
+        op << o;                        // operator<< shares the compact path
+        TEST(op.str() == compact);
+        TEST(compact.find("\"quoted \\\"text\\\"\"") != string::npos);
+        TEST(compact.find('\n') == string::npos);
+    }
+    {
+        // opt-in serialization cache: repeated json() on an unchanged node
+        // replays the stored bytes, and mutations re-arm it
+        Object o;
+        TEST(o.parse("{\"config\": {\"ttl\": 60, \"zone\": \"eu-1\"}, \"seq\": 1}"));
+        string plain = o.json();        // reference bytes, no cache yet
+
+        o.cache_json();
+        TEST(o.json() == plain);        // cache fill
+        TEST(o.json() == plain);        // cache hit
+        TEST(o.json_cache() && o.json_cache()->valid);
+
+        o.set("seq") = 2;               // mutation flips the dirty bit
+        TEST(!o.json_cache()->valid);
+        string changed = o.json();
+        TEST(changed != plain);
+        TEST(changed == Object(o).json());   // fresh copy serializes identically
+
+        // subtree caches: a clean child is spliced into the parent's walk,
+        // and non-const traversal dirties the whole access path
+        o.get<Object>("config").cache_json();
+        TEST(o.json() == changed);                    // fills the child cache
+        TEST(o.get<Object>("config").json_cache()->valid);
+        o.get<Object>("config").set("ttl") = 90;      // dirties o and config
+        TEST(!o.json_cache()->valid);
+        TEST(o.json() == Object(o).json());           // re-rendered, correct bytes
+
+        // compact and pretty flavors don't serve each other's bytes
+        string compact1, compact2;
+        StringSink s1(compact1), s2(compact2);
+        TEST(o.json(s1, false) && o.json(s2, false));
+        TEST(compact1 == compact2);
+        TEST(o.json() == Object(o).json());
+
+        o.cache_json(false);            // opting back out frees the snapshot
+        TEST(o.json_cache() == 0);
+        TEST(o.json() == Object(o).json());
+    }
+    {
+        // iterative engines: nesting depth lives on the heap, so documents
+        // far deeper than a thread stack allows parse and serialize fine.
+        // Parsed through a Reader so the arena tears the tree down flat too.
+        const int depth = 50000;
+        string doc;
+        doc.reserve(2 * depth + 1);
+        for (int i = 0; i < depth; ++i) doc += "[";
+        doc += "0";
+        for (int i = 0; i < depth; ++i) doc += "]";
+
+        Reader reader;
+        Array nested;
+        TEST(reader.parse(doc, nested));
+
+        // compact output keeps deep documents linear (pretty indentation
+        // would be quadratic at this depth) and round-trips exactly
+        string out;
+        StringSink sink(out);
+        TEST(nested.json(sink, false));
+        TEST(out == doc);
+
+        // same depth through objects, reusing the reader's frame stack
+        string odoc;
+        odoc.reserve(7 * depth + 1);
+        for (int i = 0; i < depth; ++i) odoc += "{\"a\": ";
+        odoc += "0";
+        for (int i = 0; i < depth; ++i) odoc += "}";
+        Object towers;
+        TEST(reader.parse(odoc, towers));
+        string oout;
+        StringSink osink(oout);
+        TEST(towers.json(osink, false));
+        TEST(oout == odoc);
+
+        // validate() keeps pace: whatever the parser swallows, a
+        // validate-then-parse pipeline must not reject first
+        TEST(validate(doc));
+        TEST(validate(odoc));
+        TEST(!validate(doc.substr(0, doc.size() - 1)));   // unbalanced
+
+        // the event engine walks the same depths without building a tree
+        {
+            depth_tracker events;
+            TEST(parse_events(doc, events));
+            TEST(events.peak == depth);
+            TEST(events.depth == 0);
+            TEST(events.numbers == 1);
+        }
+
+        // heap-owned trees (no Reader, no arena) are just as deep-proof:
+        // parse, deep copy, and both destructors at scope exit run on
+        // explicit stacks, not one C frame per level
+        {
+            Array deep;
+            TEST(deep.parse(doc));
+            Array copy(deep);
+            string dout;
+            StringSink dsink(dout);
+            TEST(copy.json(dsink, false));
+            TEST(dout == doc);
+        }
+        {
+            Object deep;
+            TEST(deep.parse(odoc));
+            Object copy(deep);
+            string dout;
+            StringSink dsink(dout);
+            TEST(copy.json(dsink, false));
+            TEST(dout == odoc);
+        }
+    }
+    {
+        // shared immutable subtrees: one deep copy at freeze time, then
+        // O(1) attachment everywhere, copy-on-write on first mutation
+        Object ref;
+        TEST(ref.parse("{\"limits\": {\"rps\": 100, \"burst\": 250}, \"region\": \"eu-1\"}"));
+        Shared frozen(ref);
+        TEST(!frozen.empty());
+        TEST(frozen.use_count() == 1);
+        {
+            Shared alias(frozen);           // handles share the same node
+            TEST(frozen.use_count() == 2);
+        }
+        TEST(frozen.use_count() == 1);
+
+        // freeze-time normalization: the in-place widenings const reads
+        // perform elsewhere (SSTRING_ to STRING_, INT_ to NUMBER_)
+        // happened when the snapshot was built, so const traversal of
+        // the frozen tree never writes to it
+        const Value *region = frozen.value().get<Object>().find("region");
+        TEST(region && region->type_ == Value::STRING_);
+        TEST(region->get<String>() == "eu-1");
+        const Value *rate = frozen.value().get<Object>().get<Object>("limits").find("rps");
+        TEST(rate && rate->type_ == Value::NUMBER_);
+        TEST(rate->get<Number>() == 100);
+
+        Object doc1, doc2;
+        doc1.import("config", frozen);      // O(1): refcount bump, no copy
+        doc2.import("config", frozen);
+        doc1 << "id" << 1;
+        doc2 << "id" << 2;
+        TEST(frozen.use_count() == 3);
+
+        // a shared payload serializes exactly like a deep-copied one
+        Object plain;
+        plain.import("config", Value(ref));
+        plain << "id" << 1;
+        TEST(doc1.json() == plain.json());
+
+        // const traversal reads the frozen tree in place, no detach
+        const Object &snapshot = doc2;
+        TEST(snapshot.get<Object>("config").get<Object>("limits").get<Number>("rps") == 100);
+        TEST(frozen.use_count() == 3);
+
+        // const query() reads through the shared payload without detaching
+        const Value *rps = snapshot.query("config.limits.burst");
+        TEST(rps != NULL);
+        TEST(rps->get<Number>() == 250);
+        TEST(frozen.use_count() == 3);
+
+        // the first mutable access detaches a private copy; the other
+        // holders and the snapshot itself stay untouched
+        doc1.get<Object>("config").get<Object>("limits").set("rps") = 500;
+        TEST(frozen.use_count() == 2);
+        TEST(doc1.get<Object>("config").get<Object>("limits").get<Number>("rps") == 500);
+        TEST(snapshot.get<Object>("config").get<Object>("limits").get<Number>("rps") == 100);
+        TEST(frozen.value().get<Object>().get<Object>("limits").get<Number>("rps") == 100);
+
+        // copying a document shares the payload again instead of copying
+        Object replica(doc2);
+        TEST(frozen.use_count() == 3);
+        TEST(replica.json() == doc2.json());
+
+        // an empty handle reads as null
+        Shared none;
+        TEST(none.empty() && none.use_count() == 0);
+        Object bare;
+        bare.import("config", none);
+        TEST(bare.has<Null>("config"));
+
+        // re-freezing an already shared value aliases the node instead
+        // of wrapping it twice
+        Value v;
+        v = frozen;
+        Shared again(v);
+        TEST(again.use_count() == frozen.use_count());
+    }
+    {
+        // opt-in stats counters: compiled out by default (all zeros),
+        // per-thread tallies when built with -DJSONXX_ENABLE_STATS
+#ifdef JSONXX_ENABLE_STATS
+        reset_stats();
+        string doc("{\"a\": [1, 2.5, \"three\"], \"b\": {\"c\": null}}");
+        Object o;
+        TEST(o.parse(doc));
+        Stats after = stats();
+        TEST(after.parses == 1);
+        TEST(after.bytes_parsed == doc.size());
+        TEST(after.nodes_created > 0);
+        TEST(after.strings_parsed == 4);   // three keys plus one string value
+        TEST(after.numbers_parsed == 2);
+        TEST(after.peak_depth == 2);       // root plus one nested container
+        TEST(after.parse_ns > 0);
+
+        o.json();
+        Stats serialized = stats();
+        TEST(serialized.json_ns > 0);
+        TEST(serialized.escaped_bytes >= 8);   // keys and the string value
+
+        reset_stats();
+        TEST(stats().parses == 0 && stats().bytes_parsed == 0);
+#else
+        // the snapshot API always exists; without the define it reports zeros
+        Object o;
+        TEST(o.parse("{\"a\": 1}"));
+        Stats s = stats();
+        TEST(s.parses == 0 && s.bytes_parsed == 0 && s.nodes_created == 0);
+        reset_stats();   // a no-op, but callers can leave the calls in
+#endif
+    }
+    {
+        // streaming transcoder: the event tokenizer piped straight into a
+        // Sink produces the same bytes the DOM round-trip does, with no DOM
+        string doc("{\"id\": 9223372036854775807, \"tags\": [\"a b\", 2.5, true, null], \"meta\": {\"ok\": false}, \"empty\": []}");
+
+        string pretty;
+        StringSink psink(pretty);
+        TEST(reformat(doc, psink));
+        TEST(pretty == reformat(doc));   // byte for byte against the DOM path
+
+        string compact;
+        StringSink csink(compact);
+        TEST(reformat(doc, csink, false));
+        Object o;
+        TEST(o.parse(doc));
+        string dom_compact;
+        StringSink dsink(dom_compact);
+        TEST(o.json(dsink, false));
+        TEST(compact == dom_compact);
+
+        // the xml flavors match the buffered converters, header included
+        string jx;
+        StringSink xsink(jx);
+        TEST(xml(doc, xsink, JSONx));
+        TEST(jx == xml(doc, JSONx));
+        string tx;
+        StringSink tsink(tx);
+        TEST(xml(doc, tsink, TaggedXML));
+        TEST(tx == xml(doc, TaggedXML));
+
+        // array roots stream too, and malformed input reports failure
+        string arrdoc("[1, [2, 3], {\"k\": \"v\"}]");
+        string arr;
+        StringSink asink(arr);
+        TEST(reformat(arrdoc, asink));
+        TEST(arr == reformat(arrdoc));
+        string bad;
+        StringSink bsink(bad);
+        TEST(!reformat(string("{\"broken\": "), bsink));
+
+        // deep documents stream too, now that the event engine keeps its
+        // nesting state off the thread stack; compact output for the same
+        // reason as the deep DOM test -- pretty indentation is quadratic
+        const int depth = 50000;
+        string deep;
+        deep.reserve(2 * depth + 1);
+        for (int i = 0; i < depth; ++i) deep += "[";
+        deep += "0";
+        for (int i = 0; i < depth; ++i) deep += "]";
+        string streamed;
+        StringSink deepsink(streamed);
+        TEST(reformat(deep, deepsink, false));
+        TEST(streamed == deep);
+    }
+    {
+        // binary snapshots round-trip without re-tokenizing and keep key order
+        string teststr("{\"zulu\": 9223372036854775807, \"alpha\": [1, 2.5, \"deep\"], \"s\": \"text\", \"b\": true, \"n\": null}");
+        Object o;
+        TEST(o.parse(teststr));
+        ostringstream snapshot;
+        TEST(o.save_binary(snapshot));
+        Object p;
+        istringstream restore(snapshot.str());
+        TEST(p.load_binary(restore));
+        TEST(p.json() == o.json());
+        TEST(p.get<Integer>("zulu") == 9223372036854775807LL);
+
+        istringstream garbage("not a snapshot");
+        TEST(!Object().load_binary(garbage));
+        istringstream truncated(snapshot.str().substr(0, snapshot.str().size() / 2));
+        TEST(!Object().load_binary(truncated));
+    }
+    {
+        // lazy parsing: nested containers stay raw slices of the input
+        // until first access; the buffer must outlive the document
+        string teststr("{\"version\": 3, \"payload\": {\"rows\": [1, 2, 3], \"note\": \"// not } a comment\"}}");
+        Object o;
+        TEST(o.parse_lazy(teststr));
+        TEST(o.get<Number>("version") == 3);
+        TEST(o.kv_map().find("payload")->second->type_ == Value::RAW_);
+        TEST(o.has<Object>("payload"));   // peeks the slice, no parse yet
+        TEST(o.kv_map().find("payload")->second->type_ == Value::RAW_);
+        Object& payload = o.get<Object>("payload");
+        TEST(o.kv_map().find("payload")->second->type_ == Value::OBJECT_);
+        TEST(payload.kv_map().find("rows")->second->type_ == Value::RAW_);
+        TEST(payload.get<Array>("rows").get<Number>(2) == 3);
+        TEST(o.query("payload.note") != NULL);
+
+        Object eager, relazy;
+        TEST(eager.parse(teststr));
+        TEST(relazy.parse_lazy(teststr));
+        TEST(relazy.json() == eager.json());  // serializer materializes
+    }
+    {
+        // compiled path queries: dotted and JSON Pointer syntax
+        Object o;
+        TEST(o.parse("{\"response\": {\"items\": [{\"price\": 8}, {\"price\": 9}], \"n/a\": 1}}"));
+        Path path("response.items[1].price");
+        TEST(path.valid());
+        Value* v = o.query(path);
+        TEST(v != NULL);
+        TEST(v->get<Number>() == 9);
+        TEST(o.query("/response/items/0/price") != NULL);
+        TEST(o.query("/response/items/0/price")->get<Number>() == 8);
+        TEST(o.query("/response/n~1a") != NULL);          // ~1 unescapes to '/'
+        TEST(o.query("response.items[2].price") == NULL); // out of range
+        TEST(o.query("response.missing") == NULL);
+        TEST(!Path("response.items[x]").valid());
+    }
+    {
+        // short strings are stored inline in the Value union and only
+        // materialize a heap std::string on get<String>()
+        Value v;
+        string teststr("\"id\"");
+        TEST(v.parse(teststr));
+        TEST(v.type_ == Value::SSTRING_);
+        TEST(v.is<String>());
+        TEST(string(v.sstring_data(), v.sstring_size()) == "id");
+        TEST(v.get<String>() == "id");
+        TEST(v.type_ == Value::STRING_);     // materialized by access
+
+        Value w;
+        string longstr("\"0123456789012345678901234567890\"");
+        TEST(w.parse(longstr));
+        TEST(w.type_ == Value::STRING_);
+
+        Object o;
+        TEST(o.parse("{\"k\": \"short\"}"));
+        TEST(o.json() == "{\n\t\"k\": \"short\" \n} \n");
+    }
+    {
+        // objects serialize in insertion order, so reformat() round-trips
+        // byte-identically instead of sorting keys
+        string teststr("{\"zulu\": 1, \"alpha\": 2, \"mike\": {\"yankee\": 3, \"bravo\": 4}}");
+        Object o;
+        TEST(o.parse(teststr));
+        string out = o.json();
+        TEST(out.find("\"zulu\"") < out.find("\"alpha\""));
+        TEST(out.find("\"yankee\"") < out.find("\"bravo\""));
+        TEST(jsonxx::reformat(out) == out);
+        o << "echo" << 5;
+        TEST(o.json().find("\"alpha\"") < o.json().find("\"echo\""));
+    }
+    {
+        // newline-delimited batches parse in input order; blank lines skipped
+        string batch;
+        for (int i = 0; i < 100; ++i) {
+            ostringstream line;
+            line << "{\"id\": " << i << "}\n";
+            if (i % 10 == 0) line << "\n";
+            batch += line.str();
+        }
+        std::vector<Object> docs;
+        TEST(jsonxx::parse_many(batch, docs, 2));
+        TEST(docs.size() == 100);
+        TEST(docs[0].get<Number>("id") == 0);
+        TEST(docs[99].get<Number>("id") == 99);
+        TEST(!jsonxx::parse_many(string("{\"ok\": 1}\n{broken\n"), docs));
+        TEST(docs.size() == 2);
+        TEST(docs[0].has<Number>("ok"));
+    }
     {
         string teststr("true");
         istringstream input(teststr);
@@ -536,6 +1248,88 @@ int main(int argc, const char **argv) {
         TEST( validate( o.json() ) );                 // self-evaluation
     }
 
+#if JSONXX_COMPILER_HAS_CXX11 > 0
+    {
+        // move semantics: payloads change owner instead of being deep-copied
+        jsonxx::Object o;
+        o << "key1" << "value";
+        jsonxx::Value v( std::move(o) );
+        TEST( v.is<Object>() );
+        TEST( v.get<Object>().get<String>("key1") == "value" );
+        TEST( o.empty() );
+
+        jsonxx::Array a;
+        a << 123;
+        jsonxx::Array b( std::move(a) );
+        TEST( a.empty() );
+        TEST( b.size() == 1 );
+        TEST( b.get<Number>(0) == 123 );
+
+        jsonxx::Value s( std::string("hello world") );
+        jsonxx::Value t( std::move(s) );
+        TEST( t.get<String>() == "hello world" );
+        TEST( s.empty() );
+
+        // move-assignment dirties the source's serialization cache: the
+        // gutted array must not replay its old bytes
+        jsonxx::Array c, d;
+        TEST( c.parse("[1, 2, 3]") );
+        c.cache_json();
+        std::string kept = c.json();   // fills the cache
+        d = std::move(c);
+        TEST( c.empty() );
+        TEST( c.json() == jsonxx::Array().json() );   // re-rendered empty, not the stale bytes
+        TEST( d.json() == kept );
+    }
+
+    {
+        // schema binding: JSONXX_BIND drives the tokenizer straight into
+        // the struct -- no DOM in between
+        telemetry_sample sample;
+        TEST( jsonxx::parse_into(
+            string("{\"id\": 42, \"host\": \"db-7\", \"load\": 0.75, "
+                   "\"healthy\": true, "
+                   "\"extra\": {\"ignored\": [1, 2, {\"deep\": null}]}, "
+                   "\"unbound\": 3.14}"), sample ) );
+        TEST( sample.id == 42 );
+        TEST( sample.host == "db-7" );
+        TEST( sample.load == 0.75 );
+        TEST( sample.healthy );
+
+        // absent and null keys keep whatever the struct already holds
+        telemetry_sample partial;
+        partial.host = "unset";
+        TEST( jsonxx::parse_into( string("{\"id\": 7, \"host\": null}"), partial ) );
+        TEST( partial.id == 7 );
+        TEST( partial.host == "unset" );
+        TEST( !partial.healthy );
+
+        // a bound key holding the wrong type aborts the parse
+        telemetry_sample bad;
+        TEST( !jsonxx::parse_into( string("{\"id\": \"not a number\"}"), bad ) );
+        TEST( !jsonxx::parse_into( string("{\"id\": [1, 2]}"), bad ) );
+        // so does a non-object root
+        TEST( !jsonxx::parse_into( string("[1, 2, 3]"), bad ) );
+
+        // the istream flavor shares the handler
+        istringstream stream( "{\"load\": 1.5, \"healthy\": false}" );
+        telemetry_sample streamed;
+        TEST( jsonxx::parse_into( stream, streamed ) );
+        TEST( streamed.load == 1.5 );
+
+        // a hostile document nesting an unknown-key subtree tens of
+        // thousands of levels deep is skipped flat, not recursed into
+        string hostile( "{\"id\": 9, \"junk\": " );
+        for ( int i = 0; i < 50000; ++i ) hostile += "[";
+        hostile += "0";
+        for ( int i = 0; i < 50000; ++i ) hostile += "]";
+        hostile += "}";
+        telemetry_sample survivor;
+        TEST( jsonxx::parse_into( hostile, survivor ) );
+        TEST( survivor.id == 9 );
+    }
+#endif
+
     {
         // recursion test
         jsonxx::Array a;